@@ -49,6 +49,8 @@
 #include "rtc.h"
 #include "eeprom.h"
 #include "com.h"
+#include "controller.h"
+#include "motor.h"
 
 // typedefs
 
@@ -66,35 +68,104 @@ static uint16_t CurrRAW;
  * used for calculate 1 minute difference
  ******************************************************************************/
 
+#if ADC_EMA
+/*
+ * EMA mode: every channel is a first order low pass without history,
+ * acc += x - acc/2^k and the average is acc/2^k. ring_pos still counts
+ * the seconds for ring_buf_temp_avgs. The first value fills the filter.
+ */
+static const uint8_t ema_shift[3] = {ADC_EMA_SHIFT_BAT, ADC_EMA_SHIFT_TEMP, ADC_EMA_SHIFT_CURR};
+static int32_t ema_acc[3];
+static int16_t ema_last[3];         // last value of each channel
+static uint8_t ema_filled;          // bit = ring type
+#define ring_last(type) (ema_last[type])
+#else
 static int16_t ring_buf[3][AVERAGE_LEN];
+#define ring_last(type) (ring_buf[type][(ring_pos+AVERAGE_LEN-1)%AVERAGE_LEN])
+#endif
 
 int16_t ring_buf_temp_avgs [AVGS_BUFFER_LEN];
 uint8_t ring_buf_temp_avgs_pos = 0;
 
 static uint8_t ring_pos=0;
+#if !ADC_EMA
 static uint8_t ring_used=1; 
 static int32_t ring_sum [3] = {0,0,0};
+#endif
 int16_t ring_average [3] = {0,0,0};
 
 static void shift_ring(void)
 {
 	ring_pos = (ring_pos+1) % AVERAGE_LEN;
+	#if !ADC_EMA
 	if (ring_used < AVERAGE_LEN)
 		ring_used++;
+	#endif
 
 	if (ring_pos == 0)
 	{
 		ring_buf_temp_avgs[ring_buf_temp_avgs_pos] = temp_average;
 		ring_buf_temp_avgs_pos = (ring_buf_temp_avgs_pos+1)%AVGS_BUFFER_LEN;
+		CTL_window_minmax();
 	}
 }
 
+#if SLOPE_WINDOW_DETECTION
+int16_t temp_slope = 0;    //!< change of the 1 second temperatures over AVERAGE_LEN seconds [1/100C]
+uint16_t temp_noise = 0;   //!< average step between successive 1 second temperatures [1/256 of 1/100C]
+bool temp_slope_new = false;
+
+/*!
+ *******************************************************************************
+ * slope and noise of the 1 second temperatures, call it before the new
+ * value is stored in the ring
+ * \note only for new conversions, a held reading would pull the noise
+ *       towards 0 and the EMA slope towards the held value
+ ******************************************************************************/
+static void update_slope(int16_t value)
+{
+	int16_t step = value - ring_last(TEMP_RING_TYPE);
+	#if ADC_EMA
+	if (!(ema_filled & _BV(TEMP_RING_TYPE)))
+		return; // startup condition
+	// a ramp lags (2^k-1) seconds behind in the filter
+	temp_slope = (int16_t)(((int32_t)(value - temp_average) * AVERAGE_LEN) / ((1<<ADC_EMA_SHIFT_TEMP)-1));
+	#else
+	int16_t old = ring_buf[TEMP_RING_TYPE][ring_pos];
+
+	if (old == 0)
+		return; // startup condition
+	temp_slope = value - old;
+	#endif
+	if (step < 0)
+		step = -step;
+	if (step > 50)
+		step = 50; // a real temperature change must not hide the noise
+	temp_noise += ((int16_t)(step<<8) - (int16_t)temp_noise) / 64;
+	temp_slope_new = true;
+}
+#endif
+
 static void update_ring(uint8_t type, int16_t value)
 {
+	#if ADC_EMA
+	ema_last[type] = value;
+	if (!(ema_filled & _BV(type)))
+	{
+		ema_filled |= _BV(type);
+		ema_acc[type] = (int32_t)value << ema_shift[type];
+	}
+	else
+	{
+		ema_acc[type] += value - (ema_acc[type] >> ema_shift[type]);
+	}
+	ring_average[type] = (int16_t) (ema_acc[type] >> ema_shift[type]);
+	#else
 	ring_sum[type] += value;
 	ring_sum[type] -= ring_buf[type][ring_pos]; // note for boot: it is OK, ring_buf is initialized to zeroes
 	ring_buf[type][ring_pos] = value;
 	ring_average[type] = (int16_t) (ring_sum[type]/(int32_t)(ring_used));
+	#endif
 }
 
 
@@ -184,29 +255,95 @@ bool ADC_Get_Bat_isOk(void)
  *******************************************************************************
  *  convert ACD value to temperature 
  *
+ *  \param adc in 1/4 ADC units, oversampled readings keep their extra bits
  *  \returns temperature in 1/100 degrees Celsius
  *
  *  \todo: store values for conversion in EEPROM 
  ******************************************************************************/
-static int16_t ADC_Convert_To_Degree(int16_t adc)
+#if ADC_CAL_TABLE
+static int16_t ADC_Convert_Div(int16_t adc)
+#else
+int16_t ADC_Convert_To_Degree(int16_t adc)
+#endif
 {
 	int16_t dummy;
 	uint8_t i;
-	int16_t kx=TEMP_CAL_OFFSET+(int16_t)kx_d[0];
+	int16_t kx=(TEMP_CAL_OFFSET+(int16_t)kx_d[0])<<2;
 	for (i=1; i<TEMP_CAL_N-1; i++)
 	{
-		if (adc<kx+kx_d[i])
+		if (adc<kx+((int16_t)kx_d[i]<<2))
 			break;
 		else
-			kx+=kx_d[i];
+			kx+=(int16_t)kx_d[i]<<2;
 	} // if condintion in loop is not reach i==TEMP_CAL_N-1
 
 	/*! dummy never overload int16_t 
 	 *  check values for this condition / prevent overload
 	 *        values in kx_d[1]..kx_d[TEMP_CAL_N-1] is >=16 see to \ref ee_config 
-	 *        ADC value is <1024 (OK, only 10-bit AD converter)
+	 *        ADC value is <4096 (10-bit AD converter, 2 fraction bits)
+	 *  (4*a-4*k)/(4*d) is the same as (a-k)/d for whole ADC units
 	 */
-	dummy = (int16_t) ( (((int32_t)(adc - kx))*(-TEMP_CAL_STEP)) / (int32_t)(kx_d[i]) ); 
+	dummy = (int16_t) ( (((int32_t)(adc - kx))*(-TEMP_CAL_STEP)) / ((int32_t)(kx_d[i])<<2) ); 
+
+	dummy += TEMP_CAL_N*TEMP_CAL_STEP-((int16_t)(i-1))*TEMP_CAL_STEP;
+	#if TEMP_COMPENSATE_OPTION
+	dummy += (int16_t)config.room_temp_offset*10;
+	#endif
+
+	return (dummy);        
+}
+
+#if ADC_CAL_TABLE
+/*
+ * Segment i of the calibration starts at adc_cal_kx[i-1] (1/4 ADC units)
+ * and is kx_d[i] ADC units wide. Inside a segment x*500/(4*d) is
+ * (x*adc_cal_rs[i-1])>>18 with adc_cal_rs = ceil(125*2^18/d): x < 4*d, so
+ * the rounding error of the reciprocal stays below 4*d/2^18 <= 1/d, the
+ * distance of x*125/d to the next integer. The result is exact for
+ * d <= 256. Readings outside of the calibrated range take the division.
+ */
+#define ADC_CAL_SHIFT 18
+static int16_t adc_cal_kx[TEMP_CAL_N];
+static uint32_t adc_cal_rs[TEMP_CAL_N-1];
+
+/*!
+ *******************************************************************************
+ *  rebuild the conversion table from config.temp_cal_table0..6
+ *
+ *  \note called by eeprom_config_save for every calibration byte
+ ******************************************************************************/
+void ADC_cal_update(void)
+{
+	uint8_t i;
+	int16_t kx=(TEMP_CAL_OFFSET+(int16_t)kx_d[0])<<2;
+	for (i=1; i<TEMP_CAL_N; i++)
+	{
+		adc_cal_kx[i-1] = kx;
+		adc_cal_rs[i-1] = (kx_d[i] == 0) ? 0 :
+			((((uint32_t)TEMP_CAL_STEP/4)<<ADC_CAL_SHIFT) + kx_d[i] - 1) / kx_d[i];
+		kx+=(int16_t)kx_d[i]<<2;
+	}
+	adc_cal_kx[TEMP_CAL_N-1] = kx;
+}
+
+/*!
+ *******************************************************************************
+ *  convert ACD value to temperature by the table of \ref ADC_cal_update
+ *
+ *  \param adc in 1/4 ADC units
+ *  \returns temperature in 1/100 degrees Celsius, same as the division
+ ******************************************************************************/
+int16_t ADC_Convert_To_Degree(int16_t adc)
+{
+	int16_t dummy;
+	uint8_t i;
+	if ((adc < adc_cal_kx[0]) || (adc >= adc_cal_kx[TEMP_CAL_N-1]))
+	{
+		return ADC_Convert_Div(adc); // extrapolated
+	}
+	for (i=1; adc >= adc_cal_kx[i]; i++)
+		;
+	dummy = -(int16_t)(((uint32_t)(uint16_t)(adc - adc_cal_kx[i-1]) * adc_cal_rs[i-1]) >> ADC_CAL_SHIFT);
 
 	dummy += TEMP_CAL_N*TEMP_CAL_STEP-((int16_t)(i-1))*TEMP_CAL_STEP;
 	#if TEMP_COMPENSATE_OPTION
@@ -215,7 +352,131 @@ static int16_t ADC_Convert_To_Degree(int16_t adc)
 
 	return (dummy);        
 }
+#endif
+
+
+#if ADC_OVERSAMPLE
+/*
+ * Oversampling: the temperature is read every 4^n seconds only, with the
+ * same number of conversions as one per second, taken in one burst. After
+ * the conversion that settles the channel the ADC interrupt adds up 4^n
+ * conversions without waking the ADC task, the CPU goes back to ADC noise
+ * reduction sleep after each of them. The sum shifted right by n is the
+ * reading with n more bits. The seconds in between hold the reading, so
+ * the rings keep their time base. There is no repeat on noise in this mode.
+ */
+static uint8_t adc_os;              // n of the running burst
+static volatile uint8_t adc_burst;  // conversions left in the burst
+static volatile uint16_t adc_sum;   // 16*1023 fits
+static uint8_t adc_temp_wait;       // seconds until the next burst
+static int16_t adc_temp_held;       // last reading [1/100 C]
+#endif
+#if ADC_SCHEDULE
+/*
+ * Channel schedule: the battery is converted every ADC_BAT_INTERVAL
+ * seconds, the motor current while the motor runs, the temperature every
+ * second or as ADC_OVERSAMPLE wants it. The first conversion of the
+ * sequence goes to trash for the first wanted channel, the voltage divider
+ * is only switched on for the temperature and a second without any
+ * channel leaves the ADC powered down. The rings get the last battery
+ * value and no motor current for the channels left out.
+ */
+#define ADC_BAT_INTERVAL 60
+static uint8_t adc_bat_wait;        // seconds until the next battery conversion
+#endif
+#if (ADC_SCHEDULE) || (ADC_OVERSAMPLE)
+static uint8_t adc_ch;              // channels of this second, bit = ring type
+#define ADC_WANTED(type) (adc_ch & _BV(type))
+#else
+#define ADC_WANTED(type) (true)
+#endif
+#if ADC_ADAPTIVE
+/*
+ * Adaptive interval: while the temperature is flat and the motor stands
+ * still, the measurement sequence runs every adc_interval seconds only,
+ * the interval grows by one second per flat sequence up to
+ * ADC_INTERVAL_MAX. The skipped seconds store the last samples again, the
+ * rings keep counting seconds. A temperature change, a window event or a
+ * new setpoint go back to 1 Hz at once.
+ */
+static uint8_t adc_interval;        // seconds between two sequences, 0 after an event
+static uint8_t adc_skip;            // seconds left to skip
+static int16_t adc_flat_temp;       // temperature of the last sequence [1/100 C]
+static uint8_t adc_flat_wanted;     // setpoint of the last sequence
+static bool adc_flat_window;        // window state of the last sequence
+uint8_t ADC_skip_count;
+
+/*!
+ *******************************************************************************
+ * interval after a sequence that measured temperature \a t
+ ******************************************************************************/
+static void ADC_adapt(int16_t t)
+{
+	int16_t d = t - adc_flat_temp;
+	if (d < 0)
+		d = -d;
+	#if SLOPE_WINDOW_DETECTION
+	if ((temp_slope > ADC_FLAT) || (temp_slope < -ADC_FLAT))
+		d = INT16_MAX;
+	#endif
+	if ((d > ADC_FLAT) || (adc_interval == 0))
+		adc_interval = 1;
+	else if (adc_interval < ADC_INTERVAL_MAX)
+		adc_interval++;
+	else
+		adc_interval = ADC_INTERVAL_MAX;
+	adc_flat_temp = t;
+	adc_skip = adc_interval - 1;
+}
 
+/*!
+ *******************************************************************************
+ * skipped second, the last samples go to the rings again
+ ******************************************************************************/
+static void ADC_hold(void)
+{
+	int16_t t = ring_last(TEMP_RING_TYPE);
+	update_ring(BAT_RING_TYPE, ring_last(BAT_RING_TYPE));
+	update_ring(CURR_RING_TYPE, ring_last(CURR_RING_TYPE));
+	update_ring(TEMP_RING_TYPE, t);
+	shift_ring();
+	#if ADC_OVERSAMPLE
+	if (adc_temp_wait != 0)
+		adc_temp_wait--;
+	#endif
+	#if ADC_SCHEDULE
+	if (adc_bat_wait != 0)
+		adc_bat_wait--;
+	#endif
+}
+#endif
+
+/*!
+ *******************************************************************************
+ * temperature of this second to the rings, the second is complete
+ ******************************************************************************/
+static void ADC_store_temp(int16_t t)
+{
+	#if SLOPE_WINDOW_DETECTION
+	if (ADC_WANTED(TEMP_RING_TYPE)) // not a held reading
+		update_slope(t);
+	#endif
+	update_ring(TEMP_RING_TYPE,t);
+	#if ADC_SCHEDULE
+	if (!ADC_WANTED(BAT_RING_TYPE))
+	{
+		update_ring(BAT_RING_TYPE, ring_last(BAT_RING_TYPE));
+	}
+	if (!ADC_WANTED(CURR_RING_TYPE))
+	{
+		update_ring(CURR_RING_TYPE, 0); // motor stands still
+	}
+	#endif
+	shift_ring();
+	#if ADC_ADAPTIVE
+	ADC_adapt(t);
+	#endif
+}
 
 /*!
  *******************************************************************************
@@ -224,6 +485,57 @@ static int16_t ADC_Convert_To_Degree(int16_t adc)
  ******************************************************************************/
 void start_task_ADC(void)
 {
+	#if ADC_ADAPTIVE
+	if ((CTL_temp_wanted != adc_flat_wanted) || (mode_window() != adc_flat_window)
+	 || (MOTOR_Dir != stop))
+	{
+		// event, measure now and keep 1 Hz
+		adc_flat_wanted = CTL_temp_wanted;
+		adc_flat_window = mode_window();
+		adc_interval = 0;
+		adc_skip = 0;
+	}
+	else if (adc_skip != 0)
+	{
+		adc_skip--;
+		ADC_skip_count++;
+		ADC_hold();
+		return;
+	}
+	#endif
+	#if (ADC_SCHEDULE) || (ADC_OVERSAMPLE)
+	adc_ch = _BV(BAT_RING_TYPE) | _BV(CURR_RING_TYPE) | _BV(TEMP_RING_TYPE);
+	#if ADC_OVERSAMPLE
+	if ((config.temp_oversample != 0) && (adc_temp_wait != 0))
+	{
+		// no temperature conversion in this second
+		adc_temp_wait--;
+		adc_ch &= ~_BV(TEMP_RING_TYPE);
+	}
+	#endif
+	#if ADC_SCHEDULE
+	if (adc_bat_wait != 0)
+	{
+		adc_bat_wait--;
+		adc_ch &= ~_BV(BAT_RING_TYPE);
+	}
+	else
+	{
+		adc_bat_wait = ADC_BAT_INTERVAL-1;
+	}
+	if (MOTOR_Dir == stop)
+	{
+		adc_ch &= ~_BV(CURR_RING_TYPE);
+	}
+	#if ADC_OVERSAMPLE
+	if (adc_ch == 0)
+	{
+		ADC_store_temp(adc_temp_held); // ADC stays off
+		return;
+	}
+	#endif
+	#endif
+	#endif
 	state_ADC = 1;
 	// power up ADC
 	power_up_ADC();
@@ -235,17 +547,40 @@ void start_task_ADC(void)
 	ADCSRB = 0;
 
 	ADMUX = ADC_UB_MUX | (1<<REFS0);
+	#if ADC_SCHEDULE
+	if (!ADC_WANTED(BAT_RING_TYPE))
+	{
+		// step 1 is skipped, set its prescaler here
+		ADCSRA = (1<<ADEN)|(1<<ADPS2)|(1<<ADPS0)|(1<<ADIE); // prescaler=32
+		// the conversion of step 3 or 5 goes to trash instead of step 1
+		if (ADC_WANTED(CURR_RING_TYPE))
+		{
+			ADMUX = ADC_CURR_MUX | (1<<REFS0);
+			state_ADC = 3;
+		}
+		else
+		{
+			ADC_ACT_TEMP_P |= (1<<ADC_ACT_TEMP);
+			ADMUX = ADC_TEMP_MUX | (1<<REFS0);
+			state_ADC = 5;
+		}
+	}
+	#endif
 	sleep_with_ADC = 1;
 }
 
 #define ADC_TOLERANCE 3
 static int16_t dummy_adc = 0;
+
 /*!
  *******************************************************************************
  * ADC task
  ******************************************************************************/
 bool task_ADC(void)
 {
+	int16_t ad; // shared by all steps, REPEAT_ADC is reached by goto
+	int16_t t;  // temperature, STORE_TEMP is reached by goto
+
 	switch (state_ADC)
 	{
 		case 1: //step 1
@@ -258,7 +593,14 @@ bool task_ADC(void)
 	
 		case 3: //step 3
 			{
-				int16_t ad = ADCW;
+				ad = ADCW;
+				#if ADC_SCHEDULE
+				if (!ADC_WANTED(BAT_RING_TYPE))
+				{
+					dummy_adc = ad;
+					goto BAT_DONE; // trash conversion of the current channel
+				}
+				#endif
 			
 				if ((ad>dummy_adc+ADC_TOLERANCE) || (ad<dummy_adc-ADC_TOLERANCE))
 				{ 
@@ -270,9 +612,31 @@ bool task_ADC(void)
 				}
 
 				update_ring(BAT_RING_TYPE,ADC_Get_Bat_Voltage(ad));
-
-				// activate voltage divider
-				ADC_ACT_TEMP_P |= (1<<ADC_ACT_TEMP);
+				#if ADC_SCHEDULE
+				BAT_DONE:
+				#endif
+
+				if (ADC_WANTED(TEMP_RING_TYPE))
+				{
+					// activate voltage divider
+					ADC_ACT_TEMP_P |= (1<<ADC_ACT_TEMP);
+				}
+				#if ADC_SCHEDULE
+				if (!ADC_WANTED(CURR_RING_TYPE))
+				{
+					#if ADC_OVERSAMPLE
+					if (!ADC_WANTED(TEMP_RING_TYPE))
+					{
+						t = adc_temp_held;
+						goto STORE_TEMP;
+					}
+					#endif
+					// step 5 trashes the first conversion of the temperature
+					ADMUX = ADC_TEMP_MUX | (1<<REFS0);
+					state_ADC = 4;
+					break;
+				}
+				#endif
 				ADMUX = ADC_CURR_MUX | (1<<REFS0);
 			}
 		break;
@@ -284,7 +648,14 @@ bool task_ADC(void)
 		
 		case 5:
 			{
-				int16_t ad = ADCW;
+				ad = ADCW;
+				#if ADC_SCHEDULE
+				if (!ADC_WANTED(CURR_RING_TYPE))
+				{
+					dummy_adc = ad;
+					goto CURR_DONE; // trash conversion of the temperature
+				}
+				#endif
 				if ((ad>dummy_adc+ADC_TOLERANCE)||(ad<dummy_adc-ADC_TOLERANCE))
 				{ 
 					// adc noise protection, repeat measure
@@ -293,23 +664,52 @@ bool task_ADC(void)
 
 				CurrRAW = ad;
 				update_ring(CURR_RING_TYPE, ADC_Get_Mot_Current(ad));
-
+				#if ADC_SCHEDULE
+				CURR_DONE:
+				#endif
+
+				#if ADC_OVERSAMPLE
+				if (!ADC_WANTED(TEMP_RING_TYPE))
+				{
+					t = adc_temp_held;
+					goto STORE_TEMP;
+				}
+				#endif
 				ADMUX = ADC_TEMP_MUX | (1<<REFS0);
 			}
 		break;
 
+		#if ADC_OVERSAMPLE
+		case 7: // burst is complete
+			// decimated to 1/4 ADC units, rounded
+			ad = (adc_sum + ((1 << (2*adc_os-2)) >> 1)) >> (2*adc_os-2);
+			t = adc_temp_held = ADC_Convert_To_Degree(ad);
+			adc_temp_wait = (1 << (2*adc_os)) - 1;
+			goto STORE_TEMP;
+		#endif
+
 		case 6: //step 5
+			ad = ADCW;
+			#if ADC_OVERSAMPLE
+			if (config.temp_oversample != 0)
 			{
-				int16_t ad = ADCW;
-				if ((ad>dummy_adc+ADC_TOLERANCE)||(ad<dummy_adc-ADC_TOLERANCE))
-				{ 
-					// adc noise protection, repeat measure
-					goto REPEAT_ADC; // optimization
-				}
-				int16_t t = ADC_Convert_To_Degree(ad);
-				update_ring(TEMP_RING_TYPE,t);
-				shift_ring();
+				// this conversion settles the channel, the burst follows
+				adc_os = config.temp_oversample;
+				adc_sum = 0;
+				adc_burst = 1 << (2*adc_os);
+				break;
+			}
+			#endif
+			if ((ad>dummy_adc+ADC_TOLERANCE)||(ad<dummy_adc-ADC_TOLERANCE))
+			{ 
+				// adc noise protection, repeat measure
+				goto REPEAT_ADC; // optimization
 			}
+			t = ADC_Convert_To_Degree(ad<<2);
+		#if ADC_OVERSAMPLE
+		STORE_TEMP:
+		#endif
+			ADC_store_temp(t);
 			// do not use break here
 	
 		default:
@@ -335,14 +735,27 @@ bool task_ADC(void)
  ******************************************************************************/
 
 
-// not optimized
-/*
+#if ADC_OVERSAMPLE
 ISR (ADC_vect)
 {
+	if (adc_burst != 0)
+	{
+		adc_sum += ADCW;
+		if (--adc_burst != 0)
+		{
+			sleep_with_ADC = true; // next conversion, ADC task is not woken
+			return;
+		}
+	}
 	task|=TASK_ADC;
 }
-*/
-
+#elif HOST_SIM
+// not optimized, the host build has no AVR assembler
+ISR (ADC_vect)
+{
+	task|=TASK_ADC;
+}
+#else
 // optimized
 ISR_NAKED ISR (ADC_vect)
 {
@@ -355,5 +768,6 @@ ISR_NAKED ISR (ADC_vect)
 		::"I" (_SFR_IO_ADDR(task)) , "I" (TASK_ADC_BIT)
 	);
 }
+#endif
 
 
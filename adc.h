@@ -74,6 +74,10 @@ bool ADC_Get_Bat_isOk(void);            // Status of battery ok?
 
 bool task_ADC(void);
 void start_task_ADC(void);
+int16_t ADC_Convert_To_Degree(int16_t adc); // 1/4 ADC units to 1/100 C
+#if ADC_CAL_TABLE
+void ADC_cal_update(void);
+#endif
 
 
 extern bool sleep_with_ADC;
@@ -81,5 +85,13 @@ extern int16_t ring_average[];
 extern int16_t ring_difference[];
 extern int16_t ring_buf_temp_avgs [AVGS_BUFFER_LEN];
 extern uint8_t ring_buf_temp_avgs_pos;
+#if ADC_ADAPTIVE
+extern uint8_t ADC_skip_count;     //!< seconds without measurement sequence, wraps (statistics)
+#endif
+#if SLOPE_WINDOW_DETECTION
+extern int16_t temp_slope;
+extern uint16_t temp_noise;
+extern bool temp_slope_new;        //!< temp_slope is from a new conversion, cleared by the reader
+#endif
 
 
@@ -107,6 +107,10 @@ void COM_print_debug(uint8_t type)
 	wireless_putchar(bat_average & 0xff);
 	wireless_putchar(CTL_temp_wanted); // wanted temp
 	wireless_putchar(valve_wanted); // valve pos
+	#if BAT_FORECAST
+	wireless_putchar(CTL_bat_days >> 8); // days to battery low
+	wireless_putchar(CTL_bat_days & 0xff);
+	#endif
 	wireless_async = false;
 	rfm_start_tx();
 }
@@ -218,6 +222,33 @@ void COM_wireless_command_parse (uint8_t * rfm_framebuf, uint8_t rfm_framepos)
 			wireless_putchar(menu_locked);
 			pos++;
 		break;
+
+		#if AUTOTUNE
+		case 'U':
+			if (rfm_framebuf[pos] == 1)
+				CTL_tune_start();
+			else if (rfm_framebuf[pos] == 0)
+				CTL_tune_stop(CTL_TUNE_FAILED);
+			wireless_putchar(CTL_tune_state);
+			pos++;
+		break;
+		#endif
+
+		#if EEPROM_LOG
+		case 'H':
+			wireless_putchar(rfm_framebuf[pos]);
+			{
+				uint8_t i, a = rfm_framebuf[pos] % EE_LOG_SIZE;
+				for (i = 0; i < 8; i++)
+				{
+					wireless_putchar(EEPROM_read((uint16_t)(ee_log) + a));
+					if (++a >= EE_LOG_SIZE)
+						a = 0;
+				}
+			}
+			pos++;
+		break;
+		#endif
 		
 		default:
 		break;
@@ -145,6 +145,92 @@ In this file we define only configuration parameters, for example what kind of c
 	#define BOOST_CONTROLER_AFTER_CHANGE 0
 #endif
 
+// model based controller as alternative to the PID, selected by config.ctl_mode
+#ifndef MODEL_CONTROLLER
+	#define MODEL_CONTROLLER 0
+#endif
+
+// cubic P term of the PID with 16x16->32 multiplies, 0 builds the plain 32-bit formula
+#ifndef PID_P_MUL16
+	#define PID_P_MUL16 1
+#endif
+
+// relay feedback auto-tune of the PID factors, started by the 'U' command
+#ifndef AUTOTUNE
+	#define AUTOTUNE 0
+#endif
+
+// timer switch points to a warmer temperature are "warm at", heating
+// starts early by the lead time of the learned heating rate
+#ifndef OPTIMUM_START
+	#define OPTIMUM_START 0
+#endif
+
+// valve requests are collected over config.motor_window before the motor runs
+#ifndef MOTOR_COALESCE
+	#define MOTOR_COALESCE 0
+#endif
+
+// second open window detection on the slope of the 1 second temperatures
+#ifndef SLOPE_WINDOW_DETECTION
+	#define SLOPE_WINDOW_DETECTION 0
+#endif
+
+// temperature, valve and mode history every config.log_interval minutes in EEPROM
+#ifndef EEPROM_LOG
+	#define EEPROM_LOG 0
+#endif
+
+// CTL_update does a full pass only on events, other seconds return at once
+#ifndef EVENT_CONTROLLER
+	#define EVENT_CONTROLLER 0
+#endif
+
+// temperature is read every 4^config.temp_oversample seconds as the decimated sum of a burst
+#ifndef ADC_OVERSAMPLE
+	#define ADC_OVERSAMPLE 0
+#endif
+
+// temperature conversion by a reciprocal slope table instead of a 32-bit division
+#ifndef ADC_CAL_TABLE
+	#define ADC_CAL_TABLE 0
+#endif
+
+// measurement sequence up to every ADC_INTERVAL_MAX seconds while the temperature moves no more than ADC_FLAT [0.01C]
+#ifndef ADC_ADAPTIVE
+	#define ADC_ADAPTIVE 0
+#endif
+#ifndef ADC_INTERVAL_MAX
+	#define ADC_INTERVAL_MAX 8
+#endif
+#ifndef ADC_FLAT
+	#define ADC_FLAT 5
+#endif
+
+// battery, motor current and temperature are converted on their own schedules
+#ifndef ADC_SCHEDULE
+	#define ADC_SCHEDULE 0
+#endif
+
+// averages of the ADC channels are EMA filters instead of AVERAGE_LEN boxcars, time constant 2^shift seconds
+#ifndef ADC_EMA
+	#define ADC_EMA 0
+#endif
+#ifndef ADC_EMA_SHIFT_BAT
+	#define ADC_EMA_SHIFT_BAT 4
+#endif
+#ifndef ADC_EMA_SHIFT_TEMP
+	#define ADC_EMA_SHIFT_TEMP 4
+#endif
+#ifndef ADC_EMA_SHIFT_CURR
+	#define ADC_EMA_SHIFT_CURR 2
+#endif
+
+// days until bat_low_thld from the daily battery trend, in 'D' telemetry and watch()
+#ifndef BAT_FORECAST
+	#define BAT_FORECAST 0
+#endif
+
 /**********************/
 /* code configuration */
 /**********************/
@@ -152,6 +238,11 @@ In this file we define only configuration parameters, for example what kind of c
 // enable D part of PID controller
 #define CONFIG_ENABLE_D 0
 
+// build for the host simulator ("make host", see host/hal.h)
+#ifndef HOST_SIM
+	#define HOST_SIM 0
+#endif
+
 
 /* compiler compatibility */
 #ifndef ISR_NAKED
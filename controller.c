@@ -44,6 +44,9 @@
 #include "eeprom.h"
 #include "controller.h"
 #include "keyboard.h"
+#if BAT_FORECAST
+#include "motor.h"
+#endif
 
 // global Vars for default values: temperatures and speed
 uint8_t CTL_temp_wanted = 0;					// actual desired temperature
@@ -66,6 +69,12 @@ int8_t PID_force_update = AVERAGE_LEN+1;			// signed value, val<0 means disable
 uint8_t valveHistory[VALVE_HISTORY_LEN];
 
 static uint8_t pid_Controller(int16_t setPoint, int16_t processValue, uint8_t old_result, bool updateNow);
+#if MODEL_CONTROLLER
+static uint8_t model_Controller(int16_t setPoint, int16_t processValue, uint8_t old_result, bool updateNow);
+#endif
+#if AUTOTUNE
+static void tune_update(void);
+#endif
 
 uint8_t CTL_error = 0;
 
@@ -88,23 +97,119 @@ void CTL_clear_error(int8_t err_code)
 }
 
 
-static void CTL_window_detection(void)
+static int16_t window_open_min = 10000;  // of the last window_open_detection_time averages
+static int16_t window_open_max = 0;
+static int16_t window_close_min = 10000; // of the last window_close_detection_time averages
+#if SLOPE_WINDOW_DETECTION
+static uint8_t window_slope_cnt;         // seconds with a steep temperature drop
+#endif
+
+#if EVENT_CONTROLLER
+/*
+ * Event driven evaluation
+ *
+ * A CTL_update call does the full pass only when the minute changes, on an
+ * event (new quarter-minute average, user change, auto-tune), when the
+ * timer temperature is invalid, when the PID interval or a forced update is
+ * due, or when temp_average has left the band in which the window detection
+ * cannot change state. All other seconds return at once, and the skipped
+ * seconds are taken from the PID counters before the next full pass.
+ */
+static bool ctl_wake = true;        // full pass with the next call
+static uint16_t ctl_next;           // calls from the last full pass until a counter is due
+static uint16_t ctl_skipped;        // calls skipped since the last full pass
+static int16_t ctl_temp_low;        // band of temp_average without a window state change
+static int16_t ctl_temp_high;
+uint8_t CTL_skip_count;
+
+/*!
+ *******************************************************************************
+ *  full CTL_update pass with the next call
+ *  \note call it before PID_force_update or the mode is changed from outside,
+ *        the seconds skipped so far count before the change
+ ******************************************************************************/
+void CTL_wake(void)
+{
+	PID_update_timeout = (PID_update_timeout > ctl_skipped) ? PID_update_timeout - ctl_skipped : 0;
+	if (PID_force_update > 0)
+		PID_force_update = (PID_force_update > ctl_skipped) ? PID_force_update - ctl_skipped : 0;
+	ctl_skipped = 0;
+	ctl_wake = true;
+}
+#endif
+
+//! detection time in averages, limited like ee_config as the EEPROM may hold anything
+static uint8_t window_len(uint8_t n)
 {
-	uint8_t i = (ring_buf_temp_avgs_pos+AVGS_BUFFER_LEN-((CTL_mode_window!=0)?config.window_close_detection_time:config.window_open_detection_time)) % AVGS_BUFFER_LEN;
+	return (n == 0) ? 1 : ((n > AVGS_BUFFER_LEN) ? AVGS_BUFFER_LEN : n);
+}
+
+/*!
+ *******************************************************************************
+ *  min/max of the recent quarter-minute averages for CTL_window_detection()
+ *  \note called by shift_ring() when a new average has arrived, the check
+ *        every second then uses the stored values
+ ******************************************************************************/
+void CTL_window_minmax(void)
+{
+	uint8_t i = ring_buf_temp_avgs_pos;
+	uint8_t n = 0;
+	uint8_t open_n = window_len(config.window_open_detection_time);
+	uint8_t close_n = window_len(config.window_close_detection_time);
 	int16_t min = 10000;
 	int16_t max = 0;
-	while (1)
+	int16_t x = ring_buf_temp_avgs[i];
+
+	// the oldest average (AVGS_BUFFER_LEN back) is always part of both windows
+	if (x != 0)
+		min = max = x;
+	// walk back from the newest average
+	while (n < AVGS_BUFFER_LEN)
 	{
-		int16_t x = ring_buf_temp_avgs[i];
+		i = (i + AVGS_BUFFER_LEN - 1) % AVGS_BUFFER_LEN;
+		n++;
+		x = ring_buf_temp_avgs[i];
 		if (x != 0) // startup condition
 		{
 			if (x<min) min = x;
 			if (x>max) max = x;
 		}
-		if (i == ring_buf_temp_avgs_pos)
+		if (n == open_n)
+		{
+			window_open_min = min;
+			window_open_max = max;
+		}
+		if (n == close_n)
+			window_close_min = min;
+		if ((n >= open_n) && (n >= close_n))
 			break;
-		i = (i+1) % AVGS_BUFFER_LEN;
 	}
+	#if EVENT_CONTROLLER
+	ctl_wake = true;
+	#endif
+}
+
+static void CTL_window_detection(void)
+{
+	int16_t min = (CTL_mode_window!=0) ? window_close_min : window_open_min;
+
+	#if SLOPE_WINDOW_DETECTION
+	// fast path: two new 1 second temperatures in a row fall steeply, noise
+	// of the sensor raises the threshold (5 times the average step)
+	if (temp_slope_new)
+	{
+		int16_t drop = -temp_slope;
+		temp_slope_new = false;
+		if ((config.window_slope_diff != 0) && (drop > (int16_t)config.window_slope_diff)
+			&& (drop > (int16_t)((temp_noise*5)>>8)))
+		{
+			if (window_slope_cnt < 2)
+				window_slope_cnt++;
+		}
+		else
+			window_slope_cnt = 0;
+	}
+	#endif
 	
 	if ((temp_average-min) > (int16_t)config.window_close_detection_diff)
 	{
@@ -117,7 +222,12 @@ static void CTL_window_detection(void)
 	}
 	else
 	{
-		if ((CTL_mode_window==0) && ((max-temp_average)>(int16_t)config.window_open_detection_diff))
+		bool open = ((window_open_max-temp_average)>(int16_t)config.window_open_detection_diff);
+		#if SLOPE_WINDOW_DETECTION
+		if (window_slope_cnt >= 2)
+			open = true;
+		#endif
+		if ((CTL_mode_window==0) && open)
 		{
 			CTL_mode_window = config.window_open_timeout;
 			PID_force_update = 0;
@@ -126,6 +236,244 @@ static void CTL_window_detection(void)
 	}
 }
 
+#if OPTIMUM_START
+/*
+ * Optimum start
+ *
+ * A timer switch point to a warmer temperature means "warm at this time".
+ * The heating starts early by the lead time the learned heating rate gives
+ * for the missing degrees, at most config.preheat_max. Each transition to a
+ * warmer temperature by the timers measures the rate from its start until
+ * the temperature is within PREHEAT_MARGIN of the set point, the measured
+ * rate moves config.preheat_rate a quarter of the way.
+ */
+
+#define PREHEAT_MARGIN      30      // "warm" is this close to the set point [0.01C]
+#define PREHEAT_MIN_RISE    100     // smaller rise is not learned [0.01C]
+#define PREHEAT_MAX_MINUTES (6*60)  // longer transitions are not learned
+
+static uint8_t preheat_last = 0xff; // CTL_temp_wanted seen last minute
+static uint8_t preheat_wanted;      // set point being measured, 0 = none
+static int16_t preheat_temp;        // temperature at the start of it
+static uint16_t preheat_minutes;    // since the start of it
+
+/*!
+ *******************************************************************************
+ *  start heating for the next switch point and learn the heating rate
+ *  \note call it once per minute
+ ******************************************************************************/
+static void CTL_preheat(void)
+{
+	uint16_t ahead;
+	uint8_t t = RTC_NextTimerTemperatureType(&ahead);
+
+	if ((t != TEMP_TYPE_INVALID) && (config.preheat_max != 0) && CTL_test_auto()
+		&& (temperature_table[t] > CTL_temp_wanted) && (temperature_table[t] <= TEMP_MAX))
+	{
+		int16_t diff = calc_temp(temperature_table[t]) - PREHEAT_MARGIN - temp_average;
+		// minutes = diff[0.01C] * 60 / (rate[0.1C/hour] * 10)
+		uint16_t lead = (diff > 0) ? (uint32_t)diff * 6 / config.preheat_rate : 0;
+		if (lead > (uint16_t)config.preheat_max * 10)
+			lead = (uint16_t)config.preheat_max * 10;
+		if (ahead <= lead)
+		{
+			CTL_temp_auto_type = t;
+			CTL_temp_wanted = temperature_table[t];
+			PID_force_update = 0;
+		}
+	}
+
+	if (preheat_wanted != 0)
+	{
+		if ((CTL_temp_wanted != preheat_wanted) || mode_window()
+			|| (++preheat_minutes > PREHEAT_MAX_MINUTES))
+			preheat_wanted = 0;  // disturbed, learn next time
+		else if (temp_average >= calc_temp(preheat_wanted) - PREHEAT_MARGIN)
+		{
+			int16_t rise = calc_temp(preheat_wanted) - PREHEAT_MARGIN - preheat_temp;
+			if (rise >= PREHEAT_MIN_RISE)
+			{
+				uint16_t rate = (uint32_t)rise * 6 / preheat_minutes;
+				rate = (3 * (uint16_t)config.preheat_rate + rate + 2) / 4;
+				config.preheat_rate = (rate > 255) ? 255 : ((rate < 1) ? 1 : rate);
+				eeprom_config_save((uint16_t)(&config.preheat_rate)-(uint16_t)(&config));
+			}
+			preheat_wanted = 0;
+		}
+	}
+	else if ((CTL_temp_wanted > preheat_last) && CTL_test_auto() && !mode_window())
+	{
+		preheat_wanted = CTL_temp_wanted;
+		preheat_temp = temp_average;
+		preheat_minutes = 0;
+	}
+	preheat_last = CTL_temp_wanted;
+}
+#endif
+
+#if EEPROM_LOG
+/*
+ * History log
+ *
+ * One byte per config.log_interval as long as the flags stay and the
+ * changes fit a delta record, otherwise an absolute record of 3 bytes. The
+ * deltas are taken to the values a reader decodes, so the rounding does
+ * not add up. Each byte is written twice per turn of the ring (record and
+ * end marker), about once a day with the defaults.
+ */
+
+static uint8_t log_pos = 0xff;      // write position in ee_log, 0xff = not searched yet
+static uint8_t log_minutes;         // to the next record
+static uint8_t log_flags;           // of the last absolute record
+static uint8_t log_temp;            // decoded by a reader up to now [0.1C above EE_LOG_TEMP_MIN]
+static uint8_t log_valve;
+
+static void log_put(uint8_t b)
+{
+	EEPROM_write((uint16_t)(ee_log) + log_pos, b);
+	if (++log_pos >= EE_LOG_SIZE)
+		log_pos = 0;
+}
+
+/*!
+ *******************************************************************************
+ *  write temperature, valve and mode to the history log
+ *  \note call it once per minute
+ ******************************************************************************/
+static void CTL_log(void)
+{
+	uint8_t restart = 0;
+
+	if ((config.log_interval == 0) || (temp_average == 0))
+		return;
+	if (log_pos == 0xff)
+	{
+		for (log_pos = 0; log_pos < EE_LOG_SIZE-1; log_pos++)
+			if (EEPROM_read((uint16_t)(ee_log) + log_pos) == 0xff)
+				break;
+		restart = EE_LOG_RESTART;
+		log_minutes = 0;
+	}
+	if (log_minutes > 0)
+	{
+		log_minutes--;
+		return;
+	}
+	log_minutes = config.log_interval - 1;
+
+	int16_t t = (temp_average - EE_LOG_TEMP_MIN + 5) / 10;
+	if (t < 0)
+		t = 0;
+	if (t > 250)
+		t = 250;
+	uint8_t flags = (mode_window() ? EE_LOG_WINDOW : 0) | (CTL_mode_auto ? EE_LOG_AUTO : 0)
+		| ((CTL_error != 0) ? EE_LOG_ERROR : 0);
+	uint8_t dt = (uint8_t)t - log_temp + 8;
+	uint8_t dv = (uint8_t)(valve_wanted - log_valve + 9) >> 1; // rounded, 4 = no change
+
+	if ((restart == 0) && (flags == log_flags) && (dt <= 15) && (dv <= 7)
+		&& (log_pos % EE_LOG_PAGE != 0))
+	{
+		log_put((dt << 3) | dv);
+		log_temp += dt - 8;
+		log_valve += (dv - 4) * 2;
+	}
+	else
+	{
+		if (log_pos % EE_LOG_PAGE > EE_LOG_PAGE - 3)
+		{
+			while (log_pos % EE_LOG_PAGE != 0)
+				log_put(EE_LOG_END);
+		}
+		log_put(EE_LOG_ABS | flags | restart);
+		log_put(t);
+		log_put(valve_wanted);
+		log_flags = flags;
+		log_temp = t;
+		log_valve = valve_wanted;
+	}
+	EEPROM_write((uint16_t)(ee_log) + log_pos, 0xff);
+}
+#endif
+
+#if BAT_FORECAST
+/*
+ * Battery forecast
+ *
+ * Every minute adds bat_average to the sum of the day, corrected to 20 C by
+ * BAT_TEMPCO and, while the motor runs, for the load seen in curr_average by
+ * BAT_RESISTANCE. The trend is the line from an anchor, the mean of an
+ * earlier day, to the mean of today. A single day changes by less than one
+ * ADC step, so the anchor stays at least BAT_SPAN_MIN days back; after
+ * BAT_SPAN_MAX days it moves half way up to today, the trend follows the
+ * last 16 to 32 days. A mean more than BAT_SWAP above the day before is a
+ * new battery and the new anchor. CTL_bat_days extrapolates the trend from
+ * the uncorrected mean of today down to config.bat_low_thld, the scale of
+ * CTL_ERR_BATT_LOW, 0xffff as long as there is no falling trend.
+ */
+#define BAT_TEMPCO      2       // pack voltage change [mV/C], 2 alkaline cells
+#define BAT_RESISTANCE  1       // internal resistance of the pack [mV/mA]
+#define BAT_SWAP        100     // [mV]
+#define BAT_DAY         1440    // [minutes]
+#define BAT_SPAN_MIN    4       // [days]
+#define BAT_SPAN_MAX    32      // [days]
+
+uint16_t CTL_bat_days = 0xffff;
+static int32_t bat_sum;             // corrected voltage of the day [mV]
+static int32_t bat_raw_sum;         // bat_average of the day [mV]
+static uint16_t bat_minutes;        // in bat_sum
+static int16_t bat_day;             // mean of the day before [mV], 0 = none
+static int16_t bat_anchor;          // mean of the day bat_span days back [mV]
+static uint8_t bat_span;
+
+/*!
+ *******************************************************************************
+ *  battery voltage trend and days left to bat_low_thld
+ *  \note call it once per minute
+ ******************************************************************************/
+static void CTL_bat_forecast(void)
+{
+	if (bat_average == 0)
+		return;
+	bat_raw_sum += bat_average;
+	bat_sum += bat_average
+		+ (int16_t)(((int32_t)(2000 - temp_average)*BAT_TEMPCO)/100);
+	if (MOTOR_Dir != stop)
+		bat_sum += curr_average*BAT_RESISTANCE; // the idle reading is no load
+	if (++bat_minutes < BAT_DAY)
+		return;
+
+	int16_t mean = (int16_t)(bat_sum / BAT_DAY);
+	int16_t margin = (int16_t)(bat_raw_sum / BAT_DAY) - 20*(int16_t)config.bat_low_thld;
+	bat_sum = 0;
+	bat_raw_sum = 0;
+	bat_minutes = 0;
+	if ((bat_day == 0) || (mean - bat_day > BAT_SWAP))
+	{
+		// first day or new battery
+		bat_anchor = mean;
+		bat_span = 0;
+	}
+	else if (++bat_span >= BAT_SPAN_MAX)
+	{
+		bat_anchor += (mean - bat_anchor) / 2;
+		bat_span /= 2;
+	}
+	bat_day = mean;
+
+	int16_t drop = bat_anchor - mean;
+	if ((bat_span < BAT_SPAN_MIN) || (drop <= 0))
+		CTL_bat_days = 0xffff;
+	else if (margin <= 0)
+		CTL_bat_days = 0;
+	else
+	{
+		uint32_t days = ((uint32_t)margin*bat_span) / (uint16_t)drop;
+		CTL_bat_days = (days > 0xfffe) ? 0xfffe : (uint16_t)days;
+	}
+}
+#endif
+
 
 /*!
  *******************************************************************************
@@ -137,6 +485,25 @@ static void CTL_window_detection(void)
  ******************************************************************************/
 void CTL_update(bool minute_ch)
 {
+	#if EVENT_CONTROLLER
+	if (!minute_ch && !ctl_wake && (CTL_temp_auto_type != TEMP_TYPE_INVALID)
+		&& (ctl_skipped + 1 < ctl_next)
+		&& (temp_average >= ctl_temp_low) && (temp_average <= ctl_temp_high)
+		#if SLOPE_WINDOW_DETECTION
+		&& ((config.window_slope_diff == 0)
+			|| ((window_slope_cnt == 0)
+				&& (!temp_slope_new || (-temp_slope <= (int16_t)config.window_slope_diff))))
+		#endif
+		)
+	{
+		ctl_skipped++;
+		CTL_skip_count++;
+		return;
+	}
+	CTL_wake();
+	ctl_wake = false;
+	#endif
+
 	if ( minute_ch || (CTL_temp_auto_type==TEMP_TYPE_INVALID) )
 	{
 		// minutes changed or we need return to timers
@@ -152,6 +519,18 @@ void CTL_update(bool minute_ch)
 			}
 		}
 	}
+	#if OPTIMUM_START
+	if (minute_ch)
+		CTL_preheat();
+	#endif
+	#if EEPROM_LOG
+	if (minute_ch)
+		CTL_log();
+	#endif
+	#if BAT_FORECAST
+	if (minute_ch)
+		CTL_bat_forecast();
+	#endif
 	
 	#if BOOST_CONTROLER_AFTER_CHANGE
 	if ( minute_ch && (PID_boost_timeout>0))
@@ -166,6 +545,11 @@ void CTL_update(bool minute_ch)
 	if (PID_update_timeout > 0)
 		PID_update_timeout--;
 		
+	#if AUTOTUNE
+	if (CTL_tune_running())
+		tune_update();
+	else
+	#endif
 	if (PID_force_update > 0)
 	{ 
 		PID_force_update--;
@@ -188,6 +572,11 @@ void CTL_update(bool minute_ch)
 				if (temp>TEMP_MAX)
 					new_valve = config.valve_max;
 				else
+				#if MODEL_CONTROLLER
+				if (config.ctl_mode)
+					new_valve = model_Controller(calc_temp(temp),temp_average,valveHistory[0],updateNow);
+				else
+				#endif
 					new_valve = pid_Controller(calc_temp(temp),temp_average,valveHistory[0],updateNow);
 					
 				CTL_temp_wanted_last=temp;
@@ -236,6 +625,24 @@ void CTL_update(bool minute_ch)
 				}
 			}
 		}
+
+	#if EVENT_CONTROLLER
+	// calls until the PID interval or the forced update is due
+	ctl_next = PID_update_timeout;
+	if ((PID_force_update >= 0) && (PID_force_update < ctl_next))
+		ctl_next = PID_force_update + 1;
+	// window detection: open below the low end, close above the high end
+	if (CTL_mode_window == 0)
+	{
+		ctl_temp_low = window_open_max - (int16_t)config.window_open_detection_diff;
+		ctl_temp_high = INT16_MAX;
+	}
+	else
+	{
+		ctl_temp_low = INT16_MIN;
+		ctl_temp_high = window_close_min + (int16_t)config.window_close_detection_diff;
+	}
+	#endif
 }
 
 /*!
@@ -246,6 +653,9 @@ void CTL_update(bool minute_ch)
  ******************************************************************************/
 void CTL_temp_change_inc (int8_t ch)
 {
+	#if EVENT_CONTROLLER
+	CTL_wake();
+	#endif
 	CTL_temp_wanted += ch;
 	
 	if (CTL_temp_wanted<TEMP_MIN-1)
@@ -272,6 +682,9 @@ static uint8_t menu_temp_rewoke_type;
  ******************************************************************************/
 void CTL_change_mode(int8_t m)
 {
+	#if EVENT_CONTROLLER
+	CTL_wake();
+	#endif
 	if (m == CTL_CHANGE_MODE)
 	{
 		// change
@@ -350,6 +763,44 @@ static void testIntegratorRevert(uint16_t absErr)
 }
 
 
+/*!
+ *******************************************************************************
+ * proportional term (error*error*P3_Factor/256 + P_Factor*256) * error
+ *
+ * \note error is limited to +-1200 (11 bit), the square has 21 bit. Split
+ *       into 16 bit halves the same result needs only 16x16->32 multiplies
+ *       instead of three 32x32 library calls. Bit exact to the plain
+ *       formula, the square is >= 0 so >>8 is a floor in both.
+ ******************************************************************************/
+__attribute__((noinline))    // isrbench times it per call
+static int32_t pid_P_term(int16_t error16)
+{
+#if PID_P_MUL16
+	uint16_t absErr = abs(error16);
+	uint32_t sq = (uint32_t)absErr * absErr;
+	uint16_t sq_hi = (uint16_t)(sq >> 8);          // <= 5625
+	uint8_t sq_lo = (uint8_t)sq;
+	uint32_t v;
+
+	// (sq_hi*256 + sq_lo) * P3 / 256
+	v = (uint32_t)sq_hi * config.P3_Factor
+		+ (((uint16_t)sq_lo * config.P3_Factor) >> 8)
+		+ ((uint16_t)config.P_Factor << 8);            // < 2^21
+	// v * absErr, high part of v has 5 bit only
+	v = ((uint32_t)((uint16_t)(v >> 16) * absErr) << 16)
+		+ (uint32_t)(uint16_t)v * absErr;
+	return (error16 < 0) ? -(int32_t)v : (int32_t)v;
+#else
+	int32_t pi_term;
+	pi_term = (int32_t)(error16);
+	pi_term *=  pi_term * (int32_t)config.P3_Factor;
+	pi_term >>= 8;
+	pi_term += ((uint16_t)config.P_Factor <<8);
+	pi_term *= (int32_t)error16;
+	return pi_term;
+#endif
+}
+
 static uint8_t pid_Controller(int16_t setPoint, int16_t processValue, uint8_t old_result, bool updateNow)
 {
 	int32_t /*error2,*/ pi_term;
@@ -454,11 +905,7 @@ static uint8_t pid_Controller(int16_t setPoint, int16_t processValue, uint8_t ol
 				sumError = -maxSumError;
 	}
 
-	pi_term = (int32_t)(error16);
-	pi_term *=  pi_term * (int32_t)config.P3_Factor;
-	pi_term >>= 8;
-	pi_term += ((uint16_t)config.P_Factor <<8);
-	pi_term *= (int32_t)error16;
+	pi_term = pid_P_term(error16);
 	pi_term += (int32_t)(config.I_Factor) * sumError; // maximum is 65536*50=(scalling_factor*scalling_factor*50/I_Factor)*I_Factor
 	/* 
 	* pi_term - > for overload limit: 
@@ -494,3 +941,414 @@ static uint8_t pid_Controller(int16_t setPoint, int16_t processValue, uint8_t ol
 	return (uint8_t)pi_term16;
 }
 
+#if MODEL_CONTROLLER
+/*
+ * Model based controller
+ *
+ * The room is a first order system with dead time, sampled every
+ * PID_interval:
+ *
+ *     dT = (T_eq - T) / tau,   T_eq = T_0 + gain * valve
+ *
+ * A plateau is the time between two valve moves. Inside a plateau the
+ * regression of dT over T gives -1/tau, and the mean of dT (which is just
+ * the temperature change divided by the samples) predicts the equilibrium
+ * T_eq of the current valve position long before it is reached. gain is
+ * learned from T_eq of two neighbouring plateaus.
+ *
+ * The valve is moved only when the predicted equilibrium leaves
+ * config.model_deadband around the setpoint, or when the setpoint changes.
+ * A large error is corrected by overdriving the valve and going back to
+ * the equilibrium position one sample before the setpoint is reached, two
+ * moves per temperature change.
+ */
+
+#define MODEL_SAMPLES   32      // plateau statistics are halved at this count
+#define MODEL_EQ_VALID  4       // samples for a usable equilibrium
+#define MODEL_MIN_DEV   20      // temperature deviation for tau learning [0.01C]
+#define MODEL_MIN_STEP  5       // valve step for gain learning [%]
+
+static uint16_t model_tau;          // [PID_interval*5 sec] 8.8 fixed point, 0 = not started
+static uint16_t model_gain;         // [0.01C per %] 12.4 fixed point
+static int16_t model_last_temp;
+static uint8_t model_valve;         // valve position of the plateau
+static uint8_t model_age;           // samples since the valve move
+static int8_t model_boost;          // direction of a running overdrive
+static uint8_t model_target;        // valve position after the overdrive
+
+// plateau statistics, temperatures relative to model_ref
+static uint8_t model_n;
+static int16_t model_ref;
+static int16_t model_sy;
+static int16_t model_sd;
+static int32_t model_syy;
+static int32_t model_syd;
+
+static bool model_prev_valid;       // equilibrium of the previous plateau
+static uint8_t model_prev_valve;
+static int16_t model_prev_eq;
+
+/*!
+ *******************************************************************************
+ *  equilibrium temperature of the current plateau
+ ******************************************************************************/
+static int16_t model_equilibrium(void)
+{
+	// mean(T) + tau * mean(dT)
+	return model_ref + (int16_t)(((int32_t)model_sy
+		+ (((int32_t)model_sd * model_tau) >> 8)) / model_n);
+}
+
+/*!
+ *******************************************************************************
+ *  the equilibrium is tau*mean(dT), it needs more samples for a slow room
+ ******************************************************************************/
+static bool model_eq_valid(void)
+{
+	uint8_t n = (model_tau >> 10);      // tau/4
+
+	if (n < MODEL_EQ_VALID)
+		n = MODEL_EQ_VALID;
+	else if (n > MODEL_SAMPLES/2)
+		n = MODEL_SAMPLES/2;
+	return model_n >= n;
+}
+
+/*!
+ *******************************************************************************
+ *  learn tau from the plateau: dT = -T/tau + const
+ ******************************************************************************/
+static void model_learn_tau(void)
+{
+	int32_t var = (int32_t)model_n*model_syy - (int32_t)model_sy*model_sy;
+	int32_t cov = (int32_t)model_sy*model_sd - (int32_t)model_n*model_syd; // -covariance
+
+	if ((model_n < MODEL_EQ_VALID) || (cov <= 0)
+		|| (var < (int32_t)model_n*model_n*MODEL_MIN_DEV*MODEL_MIN_DEV))
+		return;
+	while (var > 0x7fffffL)   // var<<8 must fit
+	{
+		var >>= 1;
+		cov >>= 1;
+	}
+	if (cov == 0)
+		return;
+	int32_t tau = (var << 8) / cov;
+	if (tau < 0x100)
+		tau = 0x100;
+	else if (tau > 0xff00)
+		tau = 0xff00;
+	model_tau += (int16_t)((tau - (int32_t)model_tau) / 4);
+}
+
+/*!
+ *******************************************************************************
+ *  valve has moved, close the plateau
+ ******************************************************************************/
+static void model_new_plateau(uint8_t valve)
+{
+	model_learn_tau();
+	model_prev_valid = model_eq_valid();
+	if (model_prev_valid)
+	{
+		model_prev_valve = model_valve;
+		model_prev_eq = model_equilibrium();
+	}
+	model_valve = valve;
+	model_age = 0;
+	model_n = 0;
+}
+
+/*!
+ *******************************************************************************
+ *  one sample of the running plateau
+ ******************************************************************************/
+static void model_sample(int16_t y, int16_t dy)
+{
+	if (model_n == MODEL_SAMPLES)
+	{
+		// forget the older half, the room load drifts
+		model_learn_tau();
+		model_n >>= 1;
+		model_sy >>= 1;
+		model_sd >>= 1;
+		model_syy >>= 1;
+		model_syd >>= 1;
+	}
+	if (model_n == 0)
+	{
+		model_ref = y;
+		model_sy = model_sd = 0;
+		model_syy = model_syd = 0;
+	}
+	y -= model_ref;
+	if (y > 1000) y = 1000; else if (y < -1000) y = -1000;
+	if (dy > 200) dy = 200; else if (dy < -200) dy = -200;
+	model_n++;
+	model_sy += y;
+	model_sd += dy;
+	model_syy += (int32_t)y*y;
+	model_syd += (int32_t)y*dy;
+
+	if (model_prev_valid && model_eq_valid())
+	{
+		// gain from the equilibrium of both plateaus
+		int8_t dv = model_valve - model_prev_valve;
+		if (abs(dv) >= MODEL_MIN_STEP)
+		{
+			int16_t g = (int16_t)((int32_t)(model_equilibrium() - model_prev_eq)*16 / dv);
+			if (g >= 16)
+				model_gain += (g - (int16_t)model_gain) / 4;
+		}
+		model_prev_valid = false;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  valve position that moves the equilibrium by \a dt [0.01C]
+ ******************************************************************************/
+static uint8_t model_valve_for(uint8_t valve, int16_t dt)
+{
+	int16_t v = valve + (int16_t)((int32_t)dt*16 / model_gain);
+
+	if (v > config.valve_max)
+		return config.valve_max;
+	if (v < config.valve_min)
+		return config.valve_min;
+	return (uint8_t)v;
+}
+
+/*! \brief model based control algorithm
+ *
+ *  \param setPoint  Desired value.
+ *  \param processValue  Measured value.
+ *  \param old_result  current valve position
+ *  \param updateNow  setpoint has changed
+ */
+static uint8_t model_Controller(int16_t setPoint, int16_t processValue, uint8_t old_result, bool updateNow)
+{
+	int16_t dy = processValue - model_last_temp;
+	int16_t eq;
+	uint8_t valve = old_result;
+
+	model_last_temp = processValue;
+	if (model_tau == 0)
+	{
+		model_tau = (uint16_t)config.model_tau << 8;
+		model_gain = (uint16_t)config.model_gain << 4;
+		model_valve = old_result;
+		updateNow = true;
+	}
+	if (old_result != model_valve)
+		model_new_plateau(old_result);  // moved by somebody else
+
+	if (!updateNow)
+	{
+		if (model_age < 255)
+			model_age++;
+		if ((model_age > config.model_dead_time) && !mode_window())
+			model_sample(processValue, dy);
+	}
+	eq = model_eq_valid() ? model_equilibrium() : processValue;
+
+	if (updateNow)
+		model_boost = 0;
+	if (model_boost != 0)
+	{
+		// stop the overdrive before the temperature crosses the setpoint
+		if ((model_boost > 0 ? (processValue + dy >= setPoint) : (processValue + dy <= setPoint))
+			|| (model_age > 3*(model_tau>>8)))
+		{
+			model_boost = 0;
+			valve = model_eq_valid() ? model_valve_for(old_result, setPoint - eq) : model_target;
+		}
+	}
+	else if (updateNow
+		|| (model_eq_valid() && (abs(setPoint - eq) > config.model_deadband)))
+	{
+		valve = model_valve_for(old_result, setPoint - eq);
+		int16_t err = setPoint - processValue;
+		if (abs(err) > 2*(int16_t)config.model_deadband)
+		{
+			model_target = valve;
+			model_boost = (err > 0) ? 1 : -1;
+			valve = model_valve_for(valve, (int16_t)((int32_t)err*config.model_overdrive/100));
+			if (valve == model_target)
+				model_boost = 0;
+		}
+	}
+
+	if (valve != old_result)
+		model_new_plateau(valve);
+	return valve;
+}
+#endif
+
+#if AUTOTUNE
+/*
+ * Relay feedback auto-tune (Astrom/Hagglund)
+ *
+ * The valve is switched between valve_min and valve_max like a thermostat
+ * around the wanted temperature, the room settles to a limit cycle. Its
+ * period Tu and amplitude a give the ultimate gain Ku = 4d/(pi*a), d is
+ * half the valve swing. The factors follow the Tyreus/Luyben rules
+ * (Kp = Ku/3.2, Ti = 2.2*Tu), they oscillate less than Ziegler/Nichols.
+ *
+ * The relay switches only on the PID interval like the controller it
+ * tunes, so the limit cycle includes the delay of the sampling. A relay
+ * that acts on every 15 second average finds the fast radiator to sensor
+ * path alone and a gain far too high for the PID interval.
+ */
+
+#define TUNE_HYST       20              // relay hysteresis [0.01C]
+#define TUNE_CYCLES     3               // measured oscillations
+#define TUNE_TIMEOUT    720             // [PID interval], 48 hours at 240 sec
+
+uint8_t CTL_tune_state = CTL_TUNE_IDLE;
+static uint8_t tune_wanted;             // CTL_temp_wanted at the start
+static uint16_t tune_ticks;             // [PID interval] since the start
+static uint16_t tune_up_tick;           // last switch to heating
+static uint8_t tune_ups;                // switches to heating
+static int16_t tune_min;
+static int16_t tune_max;
+static uint16_t tune_period;            // sum of the measured periods [PID interval]
+static uint16_t tune_amplitude;         // sum of the measured amplitudes [0.01C]
+
+static void tune_valve(uint8_t state)
+{
+	CTL_tune_state = state;
+	valveHistory[0] = (state == CTL_TUNE_HEAT) ? config.valve_max : config.valve_min;
+}
+
+/*!
+ *******************************************************************************
+ *  start relay auto-tune at the current wanted temperature
+ ******************************************************************************/
+void CTL_tune_start(void)
+{
+	if (CTL_tune_running())
+		return;
+	#if EVENT_CONTROLLER
+	CTL_wake();
+	#endif
+	tune_wanted = CTL_temp_wanted;
+	tune_ticks = 0;
+	tune_ups = 0;
+	tune_period = 0;
+	tune_amplitude = 0;
+	tune_min = tune_max = temp_average;
+	PID_update_timeout = config.PID_interval * 5;
+	tune_valve((temp_average < calc_temp(tune_wanted)) ? CTL_TUNE_HEAT : CTL_TUNE_COOL);
+}
+
+/*!
+ *******************************************************************************
+ *  end auto-tune, the PID takes over with the next CTL_update
+ ******************************************************************************/
+void CTL_tune_stop(uint8_t result)
+{
+	if (!CTL_tune_running())
+		return;
+	#if EVENT_CONTROLLER
+	CTL_wake();
+	#endif
+	CTL_tune_state = result;
+	PID_force_update = 0;
+}
+
+static uint8_t tune_limit(uint32_t x)
+{
+	if (x < 1)
+		return 1;
+	if (x > 255)
+		return 255;
+	return (uint8_t)x;
+}
+
+/*!
+ *******************************************************************************
+ *  factors from the limit cycle, saved to EEPROM
+ ******************************************************************************/
+static void tune_finish(void)
+{
+	uint16_t a = tune_amplitude / TUNE_CYCLES;          // [0.01C]
+	uint32_t tu = (uint32_t)tune_period * config.PID_interval * 5 / TUNE_CYCLES; // [s]
+	uint8_t d = (config.valve_max - config.valve_min) / 2;  // [%]
+
+	if (a < TUNE_HYST)
+		a = TUNE_HYST;
+	// valve[%] = P*error[0.01C]/256, Kp = Ku/3.2 = 4d/(pi*a*3.2)
+	config.P_Factor = tune_limit((uint32_t)d * 10186 / (100UL * a));
+	// sumError grows by 8*error every PID_interval*5 seconds, I/65536 of it
+	// is valve[%]: I = Kp*256 * Ts*32/Ti, Ti = 2.2*Tu
+	config.I_Factor = tune_limit((uint32_t)config.P_Factor * config.PID_interval * 5 * 320
+		/ (22 * tu));
+	// cubic part keeps the ratio of the default factors (33/8)
+	config.P3_Factor = tune_limit((uint32_t)config.P_Factor * 33 / 8);
+
+	eeprom_config_save((uint16_t)(&config.P_Factor)-(uint16_t)(&config));
+	eeprom_config_save((uint16_t)(&config.I_Factor)-(uint16_t)(&config));
+	eeprom_config_save((uint16_t)(&config.P3_Factor)-(uint16_t)(&config));
+	sumError = 0;
+	CTL_tune_stop(CTL_TUNE_DONE);
+}
+
+/*!
+ *******************************************************************************
+ *  relay step, instead of the PID in CTL_update()
+ ******************************************************************************/
+static void tune_update(void)
+{
+	int16_t sp = calc_temp(tune_wanted);
+	int16_t t;
+
+	if ((CTL_temp_wanted != tune_wanted) || mode_window())
+	{
+		CTL_tune_stop(CTL_TUNE_FAILED);  // user has changed the temperature
+		return;
+	}
+	if (PID_update_timeout > 0)
+		return;
+	PID_update_timeout = config.PID_interval * 5;
+	t = temp_average;
+	if (++tune_ticks > TUNE_TIMEOUT)
+	{
+		CTL_tune_stop(CTL_TUNE_FAILED);
+		return;
+	}
+
+	if (CTL_tune_state == CTL_TUNE_HEAT)
+	{
+		if (t < tune_min)
+			tune_min = t;
+		if (t > sp + TUNE_HYST)
+		{
+			tune_max = t;
+			tune_valve(CTL_TUNE_COOL);
+		}
+	}
+	else
+	{
+		if (t > tune_max)
+			tune_max = t;
+		if (t < sp - TUNE_HYST)
+		{
+			// one oscillation ends, the first two are the transient
+			if (++tune_ups > 2)
+			{
+				tune_period += tune_ticks - tune_up_tick;
+				tune_amplitude += (tune_max - tune_min) / 2;
+				if (tune_ups == 2 + TUNE_CYCLES)
+				{
+					tune_finish();
+					return;
+				}
+			}
+			tune_up_tick = tune_ticks;
+			tune_min = t;
+			tune_valve(CTL_TUNE_HEAT);
+		}
+	}
+}
+#endif
@@ -49,12 +49,23 @@ extern uint8_t valveHistory[VALVE_HISTORY_LEN];
 
 #define CTL_update_temp_auto() (CTL_temp_auto_type=TEMP_TYPE_INVALID)
 #define CTL_test_auto() (CTL_mode_auto && (CTL_temp_auto_type != TEMP_TYPE_INVALID) && (temperature_table[CTL_temp_auto_type]==CTL_temp_wanted))
+#if EVENT_CONTROLLER
+#define CTL_set_temp(t) (CTL_wake(), PID_force_update = 10, CTL_temp_wanted=t)
+extern uint8_t CTL_skip_count;     //!< CTL_update calls without a full pass, wraps (statistics)
+void CTL_wake(void);
+#else
 #define CTL_set_temp(t) (PID_force_update = 10, CTL_temp_wanted=t)
+#endif
+
+#if BAT_FORECAST
+extern uint16_t CTL_bat_days;      //!< days until bat_low_thld, 0xffff = unknown
+#endif
 
 void CTL_set_error(int8_t err_code);
 void CTL_clear_error(int8_t err_code);
 
 void CTL_update(bool minute_ch);
+void CTL_window_minmax(void);
 void CTL_temp_change_inc (int8_t ch);
 
 #define CTL_CHANGE_MODE        -1
@@ -79,6 +90,18 @@ extern uint8_t CTL_integratorBlock;
 #define CTL_ERR_NA_1                    (1<<1)
 #define CTL_ERR_NA_0                    (1<<0)
 
+#if AUTOTUNE
+#define CTL_TUNE_IDLE    0
+#define CTL_TUNE_DONE    1 //!< last auto-tune has saved new factors
+#define CTL_TUNE_FAILED  2 //!< aborted or no oscillation within the timeout
+#define CTL_TUNE_HEAT    3 //!< running, valve at valve_max
+#define CTL_TUNE_COOL    4 //!< running, valve at valve_min
+#define CTL_tune_running() (CTL_tune_state >= CTL_TUNE_HEAT)
+extern uint8_t CTL_tune_state;
+void CTL_tune_start(void);
+void CTL_tune_stop(uint8_t result);
+#endif
+
 extern int32_t sumError;
 extern int8_t CTL_interatorCredit;
 extern uint8_t CTL_creditExpiration;
@@ -34,6 +34,7 @@
 #include "config.h"
 #if !defined(MASTER_CONFIG_H)
 	#include "controller.h"
+	#include "adc.h"
 #endif
 #include <avr/eeprom.h>
 
@@ -55,6 +56,11 @@
 #error EEPROM layout is prepared for RTC_TIMERS_PER_DOW
 #endif 
 
+#if EEPROM_LOG
+// ee_log takes the space left by ee_config, it must still fit
+typedef char ee_log_fits[(4 + sizeof(ee_timers) + sizeof(ee_log) + sizeof(ee_config) <= E2END+1) ? 1 : -1];
+#endif
+
 
 /*!
  *******************************************************************************
@@ -111,10 +117,10 @@ void EEPROM_write(uint16_t address, uint8_t data)
 		;
 	EEAR = address;
 	EEDR = data;
-	asm ("cli");
+	cli();
 	EECR |= (1<<EEMWE);
 	EECR |= (1<<EEWE);
-	asm ("sei");
+	sei();
 }
 
 
@@ -173,6 +179,13 @@ void eeprom_config_save(uint8_t idx)
 
 			config_write(idx, config_raw[idx]);
 		}
+		#if ADC_CAL_TABLE
+		if ((idx >= (uint16_t)(&config.temp_cal_table0)-(uint16_t)(&config))
+		 && (idx <= (uint16_t)(&config.temp_cal_table6)-(uint16_t)(&config)))
+		{
+			ADC_cal_update();
+		}
+		#endif
 	}
 }
 
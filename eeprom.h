@@ -45,7 +45,12 @@
 #endif
 
 
-#define EEPROM __attribute__((section(".eeprom")))
+#if HOST_SIM
+	// host build: the EEPROM image is a data section, see host/hal.c
+	#define EEPROM __attribute__((section("host_eeprom")))
+#else
+	#define EEPROM __attribute__((section(".eeprom")))
+#endif
 
 typedef struct { // each variables must be uint8_t or int8_t without exception
     /* 00 */ uint8_t lcd_contrast;
@@ -115,6 +120,31 @@ typedef struct { // each variables must be uint8_t or int8_t without exception
  #endif
     /* unused */ 
 #endif
+#if MODEL_CONTROLLER
+	/*    */ uint8_t ctl_mode;        //!< 0 = non-linear PID, 1 = model based controller
+	/*    */ uint8_t model_tau;       //!< initial room time constant [PID_interval*5 sec]
+	/*    */ uint8_t model_gain;      //!< initial temperature change per 1% valve [unit 0.01C]
+	/*    */ uint8_t model_dead_time; //!< valve to sensor dead time [PID_interval*5 sec]
+	/*    */ uint8_t model_deadband;  //!< predicted error without valve move [unit 0.01C]
+	/*    */ uint8_t model_overdrive; //!< valve overdrive after temperature change [% of error]
+#endif
+#if OPTIMUM_START
+	/*    */ uint8_t preheat_rate;    //!< learned heating rate [0.1C/hour]
+	/*    */ uint8_t preheat_max;     //!< maximum lead time [10 minutes], 0 = heating starts at the switch point
+#endif
+#if MOTOR_COALESCE
+	/*    */ uint8_t motor_window;     //!< valve requests are collected this long [minutes], 0 = motor follows at once
+	/*    */ uint8_t motor_min_travel; //!< smallest motor run [%], raised by the measured start-up cost
+#endif
+#if SLOPE_WINDOW_DETECTION
+	/*    */ uint8_t window_slope_diff; //!< temperature drop over AVERAGE_LEN seconds for window open [unit 0.01C], 0 = off
+#endif
+#if EEPROM_LOG
+	/*    */ uint8_t log_interval; //!< history log interval [minutes], 0 = off
+#endif
+#if ADC_OVERSAMPLE
+	/*    */ uint8_t temp_oversample; //!< temperature read as 4^n conversions every 4^n seconds, 0 = every second with noise repeat
+#endif
 
 } config_t;
 
@@ -127,20 +157,42 @@ extern config_t config;
 extern uint16_t EEPROM ee_timers[8][RTC_TIMERS_PER_DOW];
 extern uint8_t EEPROM ee_layout;
 
+#if EEPROM_LOG
+/*
+ * History log, a ring of bytes written every config.log_interval minutes.
+ * The byte after the last record is always 0xff, so the write position is
+ * found again after a reset without a pointer cell that wears out.
+ * Every page starts with an absolute record, a reader starts at the first
+ * page boundary after the 0xff.
+ */
+#define EE_LOG_PAGE     20                  //!< bytes per page
+#define EE_LOG_SIZE     (9*EE_LOG_PAGE)     //!< takes the place of ee_reserved2_60 and the free space after ee_config
+extern uint8_t EEPROM ee_log[EE_LOG_SIZE];
+
+// delta record 0ttttvvv: temperature change t-8 [0.1C], valve change (v-4)*2 [%]
+#define EE_LOG_ABS      0x80    //!< 0x80|flags, temperature [0.1C above 5C], valve [%]
+#define EE_LOG_END      0xc0    //!< this byte and above: rest of the page is unused
+#define EE_LOG_TEMP_MIN 500     //!< temperature 0 of the absolute record [0.01C]
+// flags of the absolute record
+#define EE_LOG_WINDOW   0x01    //!< open window
+#define EE_LOG_AUTO     0x02    //!< timer mode
+#define EE_LOG_ERROR    0x04    //!< CTL_error set
+#define EE_LOG_RESTART  0x08    //!< first record after reset, time gap before it
+#endif
+
 // Boot Timeslots -> move to CONFIG.H
 // 10 Minutes after BOOT_hh:00
 #define BOOT_ON1       (10+0x1000) //!< 0:10
 #define BOOT_OFF1      (1430+0x0000) //!<  23:50
 
-#if (HW_WINDOW_DETECTION)
+#if (BOOST_CONTROLER_AFTER_CHANGE) || (TEMP_COMPENSATE_OPTION) || (MODEL_CONTROLLER) || (OPTIMUM_START) || (MOTOR_COALESCE) || (SLOPE_WINDOW_DETECTION) || (EEPROM_LOG) || (ADC_OVERSAMPLE)
+	#define EE_LAYOUT (0xff) 
+	// for this options we haven't reserved EE_LAYOUT number yet
+#elif (HW_WINDOW_DETECTION)
 #define EE_LAYOUT (0x15) 
 #else
 #define EE_LAYOUT (0x14) 
 #endif
-#if (BOOST_CONTROLER_AFTER_CHANGE) || (TEMP_COMPENSATE_OPTION)
-	#define EE_LAYOUT (0xff) 
-	// for this options we haven't reserved EE_LAYOUT number yet
-#endif
 
 #ifdef __EEPROM_C__
 // this is definition, not just declaration
@@ -173,6 +225,9 @@ uint16_t EEPROM ee_timers[8][RTC_TIMERS_PER_DOW] = { //128bytes
     { BOOT_ON1, BOOT_OFF1, 0x1FFF, 0x0FFF}
 };
 
+#if EEPROM_LOG
+uint8_t EEPROM ee_log[EE_LOG_SIZE] = { [0 ... EE_LOG_SIZE-1] = 0xff };
+#else
 uint8_t EEPROM ee_reserved2_60 [60] = {
     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 
     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 
@@ -183,6 +238,7 @@ uint8_t EEPROM ee_reserved2_60 [60] = {
     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 
     0xff, 0xff, 0xff, 0xff 
 };
+#endif
     
 ; // reserved for future
 #if CONFIG_ENABLE_D
@@ -275,6 +331,31 @@ uint8_t EEPROM ee_config[][4] ={  // must be alligned to 4 bytes
   /*    */  {RFM_TUNING_MODE, 0, 0x00, 0x01},   //!< RFM12 tuning mode, 0 = tuning mode off (narrow, high data rate), 1 = tuning mode on (wide, low data rate)
  #endif
 #endif
+#if MODEL_CONTROLLER
+  /*    */  {0,           0,        0,        1},   //!< ctl_mode; 0 = non-linear PID, 1 = model based controller
+  /*    */  {60,         60,        1,      255},   //!< model_tau; initial room time constant, unit PID_interval*5 sec, 4 hours
+  /*    */  {20,         20,        1,      255},   //!< model_gain; initial temperature change per 1% valve, unit 0,01C
+  /*    */  {1,           1,        0,       15},   //!< model_dead_time; valve to sensor dead time, unit PID_interval*5 sec
+  /*    */  {20,         20,        5,      255},   //!< model_deadband; predicted error without valve move, unit 0,01C
+  /*    */  {200,       200,        0,      255},   //!< model_overdrive; valve overdrive after temperature change, % of error
+#endif
+#if OPTIMUM_START
+  /*    */  {20,         20,        1,      255},   //!< preheat_rate; learned heating rate, unit 0,1C/hour, 2C/hour
+  /*    */  {18,         18,        0,       48},   //!< preheat_max; maximum lead time, unit 10 minutes, 3 hours
+#endif
+#if MOTOR_COALESCE
+  /*    */  {4,           4,        0,       60},   //!< motor_window; valve requests are collected this long, unit minutes, 0 = off
+  /*    */  {3,           3,        1,       50},   //!< motor_min_travel; smallest motor run, unit %
+#endif
+#if SLOPE_WINDOW_DETECTION
+  /*    */  {30,         30,        0,      255},   //!< window_slope_diff; temperature drop over AVERAGE_LEN seconds, unit 0.01C, 0 = off
+#endif
+#if EEPROM_LOG
+  /*    */  {20,         20,        0,      120},   //!< log_interval; history log interval, unit minutes, 0 = off
+#endif
+#if ADC_OVERSAMPLE
+  /*    */  {2,           2,        0,        2},   //!< temp_oversample; 4^n conversions every 4^n seconds, 0 = off
+#endif
 };
 
 #endif //__EEPROM_C__
@@ -0,0 +1,30 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), avr-libc header stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/avr/eeprom.h
+ * \brief      stand-in for <avr/eeprom.h> used by "make host"
+ *
+ * The firmware uses its own EEPROM routines (eeprom.c), only the
+ * header has to exist.
+ */
+
+#pragma once
+
+#include "avr/io.h"
@@ -0,0 +1,39 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/avr/interrupt.h
+ * \brief      stand-in for <avr/interrupt.h> used by "make host"
+ *
+ * An ISR is an ordinary function named after its vector, the simulator
+ * calls it directly. cli()/sei() only track the global interrupt flag.
+ */
+
+#pragma once
+
+#include "avr/io.h"
+
+#define SREG_I 7
+
+#define sei() (SREG |= _BV(SREG_I))
+#define cli() (SREG &= (uint8_t)~_BV(SREG_I))
+
+#define ISR(vector, ...) void vector(void); void vector(void)
+#define SIGNAL(vector) ISR(vector)
+#define EMPTY_INTERRUPT(vector) ISR(vector) {}
@@ -0,0 +1,217 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/avr/io.h
+ * \brief      stand-in for <avr/io.h> used by "make host"
+ *
+ * Every I/O register the firmware touches is a plain global variable
+ * defined in host/hal.c. Registers with side effects (EEPROM data/control)
+ * are routed through small accessor functions of the HAL.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+#define _SFR_IO_ADDR(sfr) (0)
+#define bit_is_set(sfr, bit) ((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit) (!((sfr) & _BV(bit)))
+
+#define E2END 0x1FF
+#define RAMEND 0x4FF
+
+#define HAL_REG8(r) extern volatile uint8_t r;
+#define HAL_REG16(r) extern volatile uint16_t r;
+
+HAL_REG8(PINA) HAL_REG8(DDRA) HAL_REG8(PORTA)
+HAL_REG8(PINB) HAL_REG8(DDRB) HAL_REG8(PORTB)
+HAL_REG8(PINC) HAL_REG8(DDRC) HAL_REG8(PORTC)
+HAL_REG8(PIND) HAL_REG8(DDRD) HAL_REG8(PORTD)
+HAL_REG8(PINE) HAL_REG8(DDRE) HAL_REG8(PORTE)
+HAL_REG8(PINF) HAL_REG8(DDRF) HAL_REG8(PORTF)
+HAL_REG8(PING) HAL_REG8(DDRG) HAL_REG8(PORTG)
+
+HAL_REG8(GPIOR0) HAL_REG8(GPIOR1) HAL_REG8(GPIOR2)
+HAL_REG8(SREG) HAL_REG8(MCUCR) HAL_REG8(MCUSR) HAL_REG8(SMCR)
+HAL_REG8(CLKPR) HAL_REG8(OSCCAL) HAL_REG8(PRR)
+HAL_REG8(EIMSK) HAL_REG8(EIFR) HAL_REG8(PCMSK0) HAL_REG8(PCMSK1)
+HAL_REG8(ACSR) HAL_REG8(DIDR0) HAL_REG8(DIDR1)
+HAL_REG8(ADMUX) HAL_REG8(ADCSRA) HAL_REG8(ADCSRB) HAL_REG16(ADCW)
+HAL_REG8(GTCCR)
+HAL_REG8(TCCR0A) HAL_REG8(TCNT0) HAL_REG8(OCR0A) HAL_REG8(TIMSK0) HAL_REG8(TIFR0)
+HAL_REG8(TCCR2A) HAL_REG8(TCNT2) HAL_REG8(OCR2A) HAL_REG8(TIMSK2) HAL_REG8(TIFR2)
+HAL_REG8(ASSR)
+HAL_REG8(WDTCR)
+HAL_REG8(LCDCRA) HAL_REG8(LCDCRB) HAL_REG8(LCDFRR) HAL_REG8(LCDCCR)
+HAL_REG8(LCDDR0) HAL_REG8(LCDDR1) HAL_REG8(LCDDR2) HAL_REG8(LCDDR3)
+HAL_REG8(LCDDR5) HAL_REG8(LCDDR6) HAL_REG8(LCDDR7) HAL_REG8(LCDDR8)
+HAL_REG8(LCDDR10) HAL_REG8(LCDDR11) HAL_REG8(LCDDR12) HAL_REG8(LCDDR13)
+HAL_REG8(LCDDR15) HAL_REG8(LCDDR16) HAL_REG8(LCDDR17) HAL_REG8(LCDDR18)
+HAL_REG16(EEAR)
+
+#define ADCL (*(volatile uint8_t *)&ADCW)
+#define ADCH (*((volatile uint8_t *)&ADCW + 1))
+
+// EEPROM data register reads/writes the emulated cell addressed by EEAR,
+// the control register completes a pending write on every access
+volatile uint8_t *hal_eedr(void);
+volatile uint8_t *hal_eecr(void);
+#define EEDR (*hal_eedr())
+#define EECR (*hal_eecr())
+
+/* port pins */
+#define PA0 0
+#define PA1 1
+#define PA2 2
+#define PA3 3
+#define PA4 4
+#define PA5 5
+#define PA6 6
+#define PA7 7
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PE0 0
+#define PE1 1
+#define PE2 2
+#define PE3 3
+#define PE4 4
+#define PE5 5
+#define PE6 6
+#define PE7 7
+#define PF0 0
+#define PF1 1
+#define PF2 2
+#define PF3 3
+#define PG3 3
+#define PG4 4
+
+/* pin change masks */
+#define PCINT0 0
+#define PCINT1 1
+#define PCINT2 2
+#define PCINT3 3
+#define PCINT4 4
+#define PCINT5 5
+#define PCINT6 6
+#define PCINT7 7
+#define PCINT8 0
+#define PCINT9 1
+#define PCINT10 2
+#define PCINT11 3
+#define PCINT12 4
+#define PCINT13 5
+#define PCINT14 6
+#define PCINT15 7
+#define INT0 0
+#define PCIE0 6
+#define PCIE1 7
+
+/* ADC */
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE 3
+#define ADIF 4
+#define ADATE 5
+#define ADSC 6
+#define ADEN 7
+#define MUX0 0
+#define ADLAR 5
+#define REFS0 6
+#define REFS1 7
+#define ADTS0 0
+#define ACD 7
+
+/* timers */
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define WGM01 3
+#define COM0A0 4
+#define COM0A1 5
+#define WGM00 6
+#define TOIE0 0
+#define OCIE0A 1
+#define TOV0 0
+#define OCF0A 1
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM21 3
+#define COM2A0 4
+#define COM2A1 5
+#define WGM20 6
+#define TOIE2 0
+#define OCIE2A 1
+#define TOV2 0
+#define OCF2A 1
+#define TCR2UB 0
+#define OCR2UB 1
+#define TCN2UB 2
+#define AS2 3
+#define EXCLK 4
+#define PSR10 0
+#define PSR2 1
+
+/* system */
+#define SE 0
+#define SM0 1
+#define SM1 2
+#define SM2 3
+#define JTD 7
+#define CLKPS0 0
+#define CLKPCE 7
+#define PRADC 0
+#define PRUSART0 1
+#define PRSPI 2
+#define PRTIM1 3
+#define PRLCD 4
+#define EERE 0
+#define EEWE 1
+#define EEPE 1
+#define EEMWE 2
+#define EEMPE 2
+
+/* LCD */
+#define LCDBL 0
+#define LCDCCD 1
+#define LCDBD 2
+#define LCDIE 3
+#define LCDIF 4
+#define LCDAB 6
+#define LCDEN 7
+#define LCDPM0 0
+#define LCDMUX0 4
+#define LCDMUX1 5
+#define LCD2B 6
+#define LCDCS 7
+#define LCDCD0 0
+#define LCDPS0 4
+#define LCDCC0 0
+#define LCDDC0 5
+#define LCDDC1 6
+#define LCDDC2 7
@@ -0,0 +1,385 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/bench.c
+ * \brief      closed-loop controller benchmark on the thermal plant model
+ *
+ * CTL_update runs once per second in the replay driver (sim.c). The
+ * sensor reads the plant (plant.c), and the valve follows valve_wanted
+ * like MOTOR_Goto would. Every scenario runs in its own process, so it
+ * starts from a fresh controller state.
+ *
+ * Metrics are taken on the sensor temperature between \ref ref and
+ * \ref until of the evaluation window:
+ *  - settle: time after \ref ref until the error stays within 0.3 K
+ *  - overshoot: largest error in the direction of \ref sign
+ *  - sse: mean error over the last hour before \ref until
+ *  - comfort: integral of the error outside the 0.3 K band [K*h]
+ * Valve moves and motor impulses count over the whole evaluation window.
+ * The score weights 1 K*h of discomfort like 1000 motor impulses, lower
+ * is better.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "config.h"
+#include "main.h"
+#include "adc.h"
+#include "eeprom.h"
+#include "controller.h"
+#include "hal.h"
+
+#include "sim.h"
+#include "plant.h"
+#include "bench.h"
+
+#define BENCH_BAND      0.3     //!< settled error band [K]
+#define BENCH_STROKE    600     //!< motor impulses from closed to open
+#define HOUR            3600UL
+
+typedef struct bench_scenario_s bench_scenario_t;
+
+struct bench_scenario_s {
+	const char *name;
+	uint32_t warmup;       //!< seconds before the evaluation window
+	uint32_t length;       //!< evaluation window [s]
+	uint32_t ref;          //!< analysis starts [s into the window]
+	uint32_t until;        //!< analysis ends [s into the window]
+	int8_t sign;           //!< +1 overshoot is above the setpoint
+	//! scenario script, \a t counts from the start of the simulation (12:00)
+	void (*script)(uint32_t t, uint8_t *setpoint, plant_state_t *s);
+};
+
+typedef struct {
+	double settle;         //!< [s], <0 not settled
+	double overshoot;      //!< [K]
+	double sse;            //!< [K]
+	double comfort;        //!< [K*h]
+	double moves_day;
+	uint32_t impulses;
+	double score;
+} bench_result_t;
+
+static plant_param_t plant;
+
+static void script_step_up(uint32_t t, uint8_t *sp, plant_state_t *s)
+{
+	*sp = (t < 12*HOUR) ? c2temp(20) : c2temp(22);
+}
+
+static void script_step_down(uint32_t t, uint8_t *sp, plant_state_t *s)
+{
+	*sp = (t < 12*HOUR) ? c2temp(22) : c2temp(19);
+}
+
+static void script_setback(uint32_t t, uint8_t *sp, plant_state_t *s)
+{
+	uint8_t hour = (12 + t/HOUR) % 24;
+	*sp = (hour >= 6 && hour < 22) ? c2temp(21) : c2temp(17);
+}
+
+static void script_window(uint32_t t, uint8_t *sp, plant_state_t *s)
+{
+	*sp = c2temp(21);
+	s->window = (t >= 12*HOUR && t < 12*HOUR + 15*60);
+}
+
+static void script_solar(uint32_t t, uint8_t *sp, plant_state_t *s)
+{
+	*sp = c2temp(21);
+	s->solar = 0;
+	if (t >= 12*HOUR && t < 18*HOUR)
+		s->solar = 600*sin(M_PI*(t - 12*HOUR)/(6*HOUR));
+}
+
+static const bench_scenario_t scenarios[] = {
+	{ "step-up",       12*HOUR, 12*HOUR, 0,        12*HOUR, +1, script_step_up },
+	{ "step-down",     12*HOUR, 12*HOUR, 0,        12*HOUR, -1, script_step_down },
+	{ "night-setback", 18*HOUR, 24*HOUR, 0,        16*HOUR, +1, script_setback },
+	{ "open-window",   12*HOUR, 12*HOUR, 15*60,    12*HOUR, +1, script_window },
+	{ "solar-gain",    12*HOUR, 12*HOUR, 0,        12*HOUR, +1, script_solar },
+};
+
+/*!
+ *******************************************************************************
+ *  run one scenario from power-on
+ ******************************************************************************/
+static void bench_scenario(const bench_scenario_t *sc, bench_result_t *r)
+{
+	plant_state_t s;
+	uint8_t sp = 0, sp_last = 0xff;
+	int16_t pos, target;
+	uint32_t t, moves = 0, last_out = 0;
+	double sse_sum = 0;
+	uint32_t sse_n = 0;
+	bool out = false;
+
+	memset(r, 0, sizeof(*r));
+	sc->script(0, &sp, &s);
+	plant_steady(&plant, &s, sp/2.0);
+	sim_start();
+	CTL_mode_auto = false;
+
+	// start at the valve position that holds the initial temperature
+	pos = target = BENCH_STROKE*config.valve_center/100;
+	#if MOTOR_COALESCE
+	hal_motor_init(BENCH_STROKE, pos);
+	#endif
+
+	for (t=0; t<sc->warmup+sc->length; t++)
+	{
+		sc->script(t, &sp, &s);
+		if (sp != sp_last)
+		{
+			CTL_set_temp(sp);
+			sp_last = sp;
+		}
+
+		double temp = plant_sensor(&plant, &s);
+		env_temp = (int16_t)lround(temp*100);
+		sim_second();
+
+		#if MOTOR_COALESCE
+		// MOTOR_Schedule calls MOTOR_Goto, the motor gets there at once
+		target = hal_motor_run(valve_wanted);
+		#else
+		// MOTOR_Goto: move to the new position when valve_wanted changes
+		target = (int16_t)valve_wanted*(BENCH_STROKE>>2)/(100>>2);
+		#endif
+		if (target != pos)
+		{
+			if (t >= sc->warmup)
+			{
+				moves++;
+				r->impulses += abs(target - pos);
+			}
+			pos = target;
+		}
+		plant_step(&plant, &s, (uint8_t)(pos*100/BENCH_STROKE), 1.0);
+
+		if (t < sc->warmup + sc->ref || t >= sc->warmup + sc->until)
+			continue;
+
+		double e = temp - sp/2.0;
+		if (sc->sign*e > r->overshoot)
+			r->overshoot = sc->sign*e;
+		if (fabs(e) > BENCH_BAND)
+		{
+			out = true;
+			last_out = t - (sc->warmup + sc->ref) + 1;
+			r->comfort += (fabs(e) - BENCH_BAND)/HOUR;
+		}
+		else
+			out = false;
+		if (t >= sc->warmup + sc->until - HOUR)
+		{
+			sse_sum += e;
+			sse_n++;
+		}
+	}
+
+	r->settle = out ? -1.0 : (double)last_out;
+	r->sse = sse_n ? sse_sum/sse_n : 0;
+	r->moves_day = moves*86400.0/sc->length;
+	r->score = r->comfort*100 + r->impulses/10.0;
+}
+
+/*!
+ *******************************************************************************
+ *  -p name=value, change one plant parameter
+ ******************************************************************************/
+bool bench_param(const char *arg)
+{
+	static const struct {
+		const char *name;
+		size_t offset;
+	} names[] = {
+		{ "c_room", offsetof(plant_param_t, c_room) },
+		{ "c_rad", offsetof(plant_param_t, c_rad) },
+		{ "ua_loss", offsetof(plant_param_t, ua_loss) },
+		{ "ua_window", offsetof(plant_param_t, ua_window) },
+		{ "ua_rad", offsetof(plant_param_t, ua_rad) },
+		{ "flow_max", offsetof(plant_param_t, flow_max) },
+		{ "t_supply", offsetof(plant_param_t, t_supply) },
+		{ "t_out", offsetof(plant_param_t, t_out) },
+		{ "sensor_coupling", offsetof(plant_param_t, sensor_coupling) },
+		{ "quick_open", offsetof(plant_param_t, quick_open) },
+		{ "draught", offsetof(plant_param_t, draught) },
+	};
+	const char *eq = strchr(arg, '=');
+	uint8_t i;
+
+	if (plant.c_room == 0)
+		plant = plant_default;
+	if (eq == NULL)
+		return false;
+	for (i=0; i<sizeof(names)/sizeof(names[0]); i++)
+	{
+		if (strlen(names[i].name) == (size_t)(eq-arg) && strncmp(arg, names[i].name, eq-arg) == 0)
+		{
+			*(double *)((char *)&plant + names[i].offset) = atof(eq+1);
+			return true;
+		}
+	}
+	if (strncmp(arg, "valve_closed=", 13) == 0)
+		plant.valve_closed = atoi(eq+1);
+	else if (strncmp(arg, "valve_open=", 11) == 0)
+		plant.valve_open = atoi(eq+1);
+	else
+		return false;
+	return true;
+}
+
+/*!
+ *******************************************************************************
+ *  run one scenario in a child process
+ ******************************************************************************/
+static bool bench_fork(const bench_scenario_t *sc, bench_result_t *r)
+{
+	int fd[2], status;
+	pid_t pid;
+	bool ok;
+
+	if (plant.c_room == 0)
+		plant = plant_default;
+	if (pipe(fd) != 0)
+		return false;
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0)
+		return false;
+	if (pid == 0)
+	{
+		close(fd[0]);
+		bench_scenario(sc, r);
+		if (write(fd[1], r, sizeof(*r)) != sizeof(*r))
+			_exit(1);
+		_exit(0);
+	}
+	close(fd[1]);
+	ok = (read(fd[0], r, sizeof(*r)) == sizeof(*r));
+	close(fd[0]);
+	waitpid(pid, &status, 0);
+	return ok;
+}
+
+/*!
+ *******************************************************************************
+ *  run all scenarios with the configuration in the EEPROM
+ *
+ *  \returns false if a scenario did not deliver a result
+ ******************************************************************************/
+bool bench_eval(bench_total_t *total)
+{
+	uint8_t i;
+
+	memset(total, 0, sizeof(*total));
+	for (i=0; i<sizeof(scenarios)/sizeof(scenarios[0]); i++)
+	{
+		bench_result_t r;
+
+		if (!bench_fork(&scenarios[i], &r))
+			return false;
+		total->comfort += r.comfort;
+		total->impulses += r.impulses;
+		total->score += r.score;
+	}
+	return true;
+}
+
+#if AUTOTUNE
+/*!
+ *******************************************************************************
+ *  -T option: relay auto-tune on the plant at 21 C, the scenarios then run
+ *  with the factors it has saved to the EEPROM
+ ******************************************************************************/
+bool bench_tune(void)
+{
+	plant_state_t s;
+	uint8_t sp = c2temp(21);
+	uint32_t t;
+
+	if (plant.c_room == 0)
+		plant = plant_default;
+	memset(&s, 0, sizeof(s));
+	plant_steady(&plant, &s, sp/2.0);
+	sim_start();
+	CTL_mode_auto = false;
+	CTL_set_temp(sp);
+
+	for (t=0; t<72*HOUR; t++)
+	{
+		if (t == HOUR)
+			CTL_tune_start();
+		env_temp = (int16_t)lround(plant_sensor(&plant, &s)*100);
+		sim_second();
+		if (t > HOUR && !CTL_tune_running())
+			break;
+		plant_step(&plant, &s, valve_wanted, 1.0);
+	}
+	if (CTL_tune_state != CTL_TUNE_DONE)
+	{
+		fprintf(stderr, "auto-tune failed after %.1f h\n", (t - HOUR)/3600.0);
+		return false;
+	}
+	printf("auto-tune   %.1f h, P_Factor %u I_Factor %u P3_Factor %u\n",
+		(t - HOUR)/3600.0, config.P_Factor, config.I_Factor, config.P3_Factor);
+	return true;
+}
+#endif
+
+/*!
+ *******************************************************************************
+ *  run all scenarios and print the results
+ ******************************************************************************/
+int bench_run(void)
+{
+	uint8_t i;
+	double total = 0;
+
+	printf("%-14s %9s %9s %7s %9s %8s %9s %8s\n", "scenario",
+		"settle/min", "overshoot", "sse/K", "moves/day", "impulses", "comfort/Kh", "score");
+	for (i=0; i<sizeof(scenarios)/sizeof(scenarios[0]); i++)
+	{
+		bench_result_t r;
+
+		if (!bench_fork(&scenarios[i], &r))
+		{
+			fprintf(stderr, "%s: no result\n", scenarios[i].name);
+			return 1;
+		}
+		if (r.settle < 0)
+			printf("%-14s %10s", scenarios[i].name, "-");
+		else
+			printf("%-14s %10.1f", scenarios[i].name, r.settle/60);
+		printf(" %9.2f %7.2f %9.1f %8u %10.2f %8.1f\n",
+			r.overshoot, r.sse, r.moves_day, r.impulses, r.comfort, r.score);
+		total += r.score;
+	}
+	printf("%-14s %74.1f\n", "total", total);
+	return 0;
+}
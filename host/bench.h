@@ -0,0 +1,43 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/bench.h
+ * \brief      closed-loop controller benchmark on the thermal plant model
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "config.h"
+
+//! sum over all scenarios
+typedef struct {
+	double comfort;        //!< [K*h]
+	uint32_t impulses;
+	double score;
+} bench_total_t;
+
+bool bench_param(const char *arg);
+bool bench_eval(bench_total_t *total);
+#if AUTOTUNE
+bool bench_tune(void);
+#endif
+int bench_run(void);
@@ -0,0 +1,812 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/des.c
+ * \brief      discrete-event simulation of the firmware main loop
+ *
+ * Peripheral state is kept in simulator variables and compared against the
+ * I/O registers after every piece of firmware code (ISR or main loop pass),
+ * so a register write is seen as a prescaler change, counter reload, ADC
+ * start etc. Next event times are always recomputed from that state, there
+ * is no event queue to invalidate.
+ *
+ * Simplifications:
+ *  - timer0 and the ADC keep their clock in every sleep mode
+ *  - an interrupt that became pending while the CPU was busy is served
+ *    after the current piece of code, no nesting
+ *  - CPU time comes from \ref des_cost_irq / \ref des_cost_task, not from
+ *    the code actually executed
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "config.h"
+#include "task.h"
+#include "adc.h"
+#include "rfm_config.h"
+#include "rfm.h"
+#include "controller.h"
+
+#include "hal.h"
+#include "des.h"
+#include "rfm12.h"
+
+int firmware_main(void);
+
+void PCINT0_vect(void);
+void PCINT1_vect(void);
+void TIMER2_COMP_vect(void);
+void TIMER2_OVF_vect(void);
+void TIMER0_OVF_vect(void);
+void ADC_vect(void);
+void LCD_vect(void);
+
+des_stats_t des_stats;
+des_time_t des_now;
+des_wait_hook_t des_wait_hook;
+
+const char * const des_irq_name[DES_IRQS] = {
+	"PCINT0", "PCINT1", "TIMER2_COMP", "TIMER2_OVF", "TIMER0_OVF", "ADC", "LCD"
+};
+
+const char * const des_mode_name[DES_MODES] = {
+	"active", "idle", "adc-nr", "power-save", "power-down"
+};
+
+const char * const des_rfm_name[DES_RFM_STATES] = {
+	"rfm-sleep", "rfm-xtal", "rfm-synth", "rfm-rx", "rfm-tx"
+};
+
+static const char * const des_task_name[8] = {
+	"TASK_KB", "TASK_RTC", "TASK_ADC", "TASK_LCD",
+	"TASK_MOTOR_PULSE", "TASK_MOTOR_STOP", "TASK_COM", "TASK_RFM"
+};
+
+/*
+ * Default cycle costs, estimated from the generated AVR code: interrupt
+ * entry/exit (wake-up, vector jump, prologue, reti) is included in every
+ * ISR, the naked ISRs are little more than that.
+ */
+uint16_t des_cost_irq[DES_IRQS] = {
+	80,     // PCINT0: motor eye and RFM SDO
+	40,     // PCINT1: keys
+	160,    // TIMER2_COMP: RTC software timers
+	20,     // TIMER2_OVF
+	60,     // TIMER0_OVF: motor supervision
+#if ADC_OVERSAMPLE
+	45,     // ADC: sum of the oversampling burst
+#else
+	12,     // ADC
+#endif
+	12,     // LCD
+};
+
+uint16_t des_cost_task[8] = {
+	250,    // TASK_KB
+	2500,   // TASK_RTC: RTC_AddOneSecond, CTL_update, radio slots
+	600,    // TASK_ADC: one step of the measurement sequence
+	300,    // TASK_LCD
+	150,    // TASK_MOTOR_PULSE
+	300,    // TASK_MOTOR_STOP
+	0,      // TASK_COM
+	400,    // TASK_RFM
+};
+
+uint16_t des_cost_loop = 40;
+uint16_t des_cost_display = 3000;
+uint16_t des_cost_ctl = 700;      // window detection, battery check, counters
+uint16_t des_cost_ctl_skip = 40;  // compares of the early return
+uint16_t des_cost_adc_hold = 250; // three ring updates and the slope
+
+int16_t des_motor_stroke = 600;
+int16_t des_motor_pos = 300;
+uint32_t des_motor_period = 94000;
+uint16_t des_motor_current = 30;
+
+static des_time_t des_end;
+static jmp_buf des_exit;
+static uint8_t des_pending;        //!< interrupt flags, bit = \ref des_irq_t
+static uint8_t des_wake_task;      //!< tasks found when the CPU woke up
+#if EVENT_CONTROLLER
+static uint8_t des_ctl_skip_count; //!< CTL_skip_count at the last sleep
+#endif
+#if ADC_ADAPTIVE
+static uint8_t des_adc_skip_count; //!< ADC_skip_count at the last sleep
+#endif
+
+/*!
+ *******************************************************************************
+ *  8 bit timer running from a prescaled clock
+ *
+ *  The counter value is derived from the time: clock n after \ref base
+ *  counts \ref base_cnt + n. Overflow and compare remember the last clock
+ *  they have been handled for.
+ ******************************************************************************/
+typedef struct {
+	des_time_t period;     //!< one timer clock, 0 = stopped
+	des_time_t base;       //!< time of clock 0
+	uint8_t base_cnt;      //!< counter at clock 0
+	uint8_t tcnt;          //!< counter value last shown to the firmware
+	uint8_t tccr;          //!< last seen control register
+	uint8_t ocr;           //!< last seen compare register
+	uint64_t done_ovf;
+	uint64_t done_cmp;
+	uint64_t clock;        //!< cached result of timer_clock()
+	des_time_t clock_end;  //!< cache is valid before this time
+} des_timer_t;
+
+static des_timer_t t0, t2;
+
+static uint64_t timer_clock(des_timer_t *t)
+{
+	// most calls are within the same timer clock, avoid the division
+	if (des_now >= t->clock_end || des_now < t->clock_end - t->period)
+	{
+		t->clock = (des_now - t->base)/t->period;
+		t->clock_end = t->base + (t->clock + 1)*t->period;
+	}
+	return t->clock;
+}
+
+static uint8_t timer_count(des_timer_t *t)
+{
+	if (t->period == 0)
+		return t->base_cnt;
+	return (uint8_t)(t->base_cnt + timer_clock(t));
+}
+
+//! time of the first clock after \a done at which the counter becomes \a value
+static des_time_t timer_next(const des_timer_t *t, uint64_t done, uint8_t value, uint64_t *clock)
+{
+	uint64_t c = done + 1;
+	c += (uint8_t)(value - (uint8_t)(t->base_cnt + c));
+	*clock = c;
+	return t->base + c*t->period;
+}
+
+static void timer_rebase(des_timer_t *t, des_time_t period, uint8_t cnt)
+{
+	t->period = period;
+	t->base = des_now;
+	t->base_cnt = cnt;
+	t->done_ovf = 0;
+	t->done_cmp = 0;
+	t->clock = 0;
+	t->clock_end = des_now + period;
+}
+
+static const uint16_t t2_prescaler[8] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+static const uint16_t t0_prescaler[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+
+/* ADC */
+static des_time_t adc_done;        //!< end of running conversion, 0 = idle
+static bool adc_first = true;      //!< next conversion takes 25 ADC clocks
+
+/* LCD */
+static des_time_t lcd_cleared;     //!< LCD interrupt flag cleared last time
+
+/* motor and photo eye */
+static int8_t motor_dir;
+static des_time_t motor_since;
+static des_time_t eye_next;        //!< next eye edge, 0 = motor stopped or stalled
+static bool eye_high;
+static des_time_t motor_charged;   //!< motor_charge is complete up to here
+
+/* radio */
+static des_rfm_t rfm_state;
+static des_time_t rfm_since;
+
+/* key script */
+typedef struct {
+	des_time_t t;
+	uint8_t pinb;
+} des_key_t;
+
+static des_key_t *keys;
+static unsigned keys_n, keys_pos;
+
+/* next event */
+enum {
+	DES_EV_STALE = -2,
+	DES_EV_T2OVF = 0,
+	DES_EV_T2COMP,
+	DES_EV_T0OVF,
+	DES_EV_ADC,
+	DES_EV_LCD,
+	DES_EV_EYE,
+	DES_EV_KEY,
+	DES_EV_RFM,
+};
+
+static int next_ev = DES_EV_STALE;  //!< result of the last des_next()
+static des_time_t next_time;
+
+//! a source has changed, des_next() must look again
+static void des_changed(void)
+{
+	next_ev = DES_EV_STALE;
+}
+
+/*!
+ *******************************************************************************
+ *  CPU executes code for \a cycles
+ ******************************************************************************/
+static void des_busy(uint32_t cycles)
+{
+	des_time_t d = cycles*DES_CYCLE;
+	des_now += d;
+	des_stats.time[DES_MODE_ACTIVE] += d;
+}
+
+static des_time_t lcd_frame(void)
+{
+	static const uint16_t lcd_prescaler[8] = { 16, 64, 128, 256, 512, 1024, 2048, 4096 };
+	uint8_t k = (((LCDCRB >> LCDMUX0) & 3) == 2) ? 6 : 8;
+	des_time_t p = (des_time_t)k * lcd_prescaler[(LCDFRR >> LCDPS0) & 7] * ((LCDFRR & 7) + 1);
+
+	return p * ((LCDCRB & _BV(LCDCS)) ? DES_TICK32K : DES_CYCLE);
+}
+
+//! enabled interrupts, bit = \ref des_irq_t
+static uint8_t irq_enabled(void)
+{
+	uint8_t m = 0;
+
+	if (EIMSK & _BV(PCIE0))     m |= _BV(DES_IRQ_PCINT0);
+	if (EIMSK & _BV(PCIE1))     m |= _BV(DES_IRQ_PCINT1);
+	if (TIMSK2 & _BV(OCIE2A))   m |= _BV(DES_IRQ_T2COMP);
+	if (TIMSK2 & _BV(TOIE2))    m |= _BV(DES_IRQ_T2OVF);
+	if (TIMSK0 & _BV(TOIE0))    m |= _BV(DES_IRQ_T0OVF);
+	if (ADCSRA & _BV(ADIE))     m |= _BV(DES_IRQ_ADC);
+	if (LCDCRA & _BV(LCDIE))    m |= _BV(DES_IRQ_LCD);
+	return m;
+}
+
+static void irq_call(des_irq_t irq)
+{
+	switch (irq)
+	{
+		case DES_IRQ_PCINT0: PCINT0_vect(); break;
+		case DES_IRQ_PCINT1: PCINT1_vect(); break;
+		case DES_IRQ_T2COMP: TIMER2_COMP_vect(); break;
+		case DES_IRQ_T2OVF:  TIMER2_OVF_vect(); break;
+		case DES_IRQ_T0OVF:  TIMER0_OVF_vect(); break;
+		case DES_IRQ_ADC:    ADC_vect(); break;
+		case DES_IRQ_LCD:    LCD_vect(); break;
+		default: break;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  show the current counter values to the firmware
+ ******************************************************************************/
+static void des_regs_out(void)
+{
+	TCNT2 = t2.tcnt = timer_count(&t2);
+	TCNT0 = t0.tcnt = timer_count(&t0);
+}
+
+/*!
+ *******************************************************************************
+ *  charge drawn by the motor since the last call, at the current the
+ *  firmware itself has measured (curr_average)
+ ******************************************************************************/
+static void motor_account(void)
+{
+	if (motor_dir != 0 && curr_average > 0)
+		des_stats.motor_charge += (double)(des_now - motor_charged)*curr_average/DES_SECOND;
+	motor_charged = des_now;
+}
+
+/*!
+ *******************************************************************************
+ *  current through the motor shunt, input of the ADC_CURR_MUX channel
+ ******************************************************************************/
+uint16_t des_motor_load(void)
+{
+	return (motor_dir != 0) ? des_motor_current : 0;
+}
+
+/*!
+ *******************************************************************************
+ *  RFM12 power management command, hal_rfm_hook
+ ******************************************************************************/
+static void des_rfm(uint8_t power)
+{
+	des_rfm_t state;
+
+	if (power & (RFM_POWER_MANAGEMENT_ET & 0xff))
+		state = DES_RFM_TX;
+	else if (power & (RFM_POWER_MANAGEMENT_ER & 0xff))
+		state = DES_RFM_RX;
+	else if (power & (RFM_POWER_MANAGEMENT_ES & 0xff))
+		state = DES_RFM_SYNTH;
+	else if (power & (RFM_POWER_MANAGEMENT_EX & 0xff))
+		state = DES_RFM_XTAL;
+	else
+		state = DES_RFM_SLEEP;
+	des_stats.rfm_time[rfm_state] += des_now - rfm_since;
+	rfm_since = des_now;
+	rfm_state = state;
+}
+
+/*!
+ *******************************************************************************
+ *  pick up register writes of the code that has just run
+ ******************************************************************************/
+static void des_sync(void)
+{
+	uint8_t cs;
+	int8_t dir;
+
+	/* timer2 */
+	cs = TCCR2A & 7;
+	if (cs != (t2.tccr & 7) || TCNT2 != t2.tcnt)
+	{
+		uint8_t cnt = (TCNT2 != t2.tcnt) ? TCNT2 : timer_count(&t2);
+		timer_rebase(&t2, t2_prescaler[cs]*DES_TICK32K, cnt);
+	}
+	t2.tccr = TCCR2A;
+	if (OCR2A != t2.ocr)
+	{
+		// a new compare value must not match on clocks that already passed
+		if (t2.period != 0 && timer_clock(&t2) > t2.done_cmp)
+			t2.done_cmp = timer_clock(&t2);
+		t2.ocr = OCR2A;
+	}
+	if (TIFR2 & _BV(OCF2A))
+		des_pending &= ~_BV(DES_IRQ_T2COMP);
+	if (TIFR2 & _BV(TOV2))
+		des_pending &= ~_BV(DES_IRQ_T2OVF);
+	TIFR2 = 0;
+
+	/* timer0, only the overflow is used */
+	cs = TCCR0A & 7;
+	if (cs != (t0.tccr & 7) || TCNT0 != t0.tcnt)
+	{
+		uint8_t cnt = (TCNT0 != t0.tcnt) ? TCNT0 : timer_count(&t0);
+		timer_rebase(&t0, t0_prescaler[cs]*DES_CYCLE, cnt);
+	}
+	t0.tccr = TCCR0A;
+	if (TIFR0 & _BV(TOV0))
+		des_pending &= ~_BV(DES_IRQ_T0OVF);
+	TIFR0 = 0;
+	des_regs_out();
+
+	/* ADC */
+	if (!(ADCSRA & _BV(ADEN)))
+	{
+		ADCSRA &= (uint8_t)~_BV(ADSC);
+		adc_done = 0;
+		adc_first = true;
+	}
+	else if ((ADCSRA & _BV(ADSC)) && adc_done == 0)
+	{
+		uint8_t ps = ADCSRA & 7;
+		des_time_t div = (ps == 0) ? 2 : (1 << ps);
+
+		adc_done = des_now + (adc_first ? 25 : 13)*div*DES_CYCLE;
+		adc_first = false;
+	}
+
+	/* motor H-bridge, PE7 opens and PE6 closes */
+	switch (PORTE & (_BV(PE6) | _BV(PE7)))
+	{
+		case _BV(PE7): dir = 1; break;
+		case _BV(PE6): dir = -1; break;
+		default: dir = 0; break;
+	}
+	motor_account();
+	if (dir != motor_dir)
+	{
+		if (motor_dir != 0)
+			des_stats.motor_time += des_now - motor_since;
+		motor_since = des_now;
+		motor_dir = dir;
+		eye_next = 0;
+		if (dir != 0 && des_motor_period != 0)
+		{
+			// spin-up, first gear tooth needs half a period
+			eye_next = des_now + (des_time_t)des_motor_period*DES_SECOND/2000000;
+		}
+	}
+	if (!(PORTE & _BV(PE2)))
+		PINE &= (uint8_t)~_BV(PE1);        // photo eye off, no light on the receiver
+	des_changed();
+}
+
+/*!
+ *******************************************************************************
+ *  earliest event, returns -1 if there is none
+ *
+ *  The result only changes with the state of the sources, it is kept until
+ *  \ref des_sync() or \ref des_fire() call des_changed().
+ ******************************************************************************/
+static int des_next(des_time_t *when)
+{
+	int ev = -1;
+	des_time_t best = UINT64_MAX, t;
+	uint64_t clock;
+
+	if (next_ev != DES_EV_STALE)
+	{
+		*when = next_time;
+		return next_ev;
+	}
+
+#define DES_CANDIDATE(e, time) \
+	do { t = (time); if (t < best) { best = t; ev = (e); } } while (0)
+
+	if (t2.period != 0)
+	{
+		DES_CANDIDATE(DES_EV_T2OVF, timer_next(&t2, t2.done_ovf, 0, &clock));
+		DES_CANDIDATE(DES_EV_T2COMP, timer_next(&t2, t2.done_cmp, t2.ocr+1, &clock));
+	}
+	if (t0.period != 0)
+		DES_CANDIDATE(DES_EV_T0OVF, timer_next(&t0, t0.done_ovf, 0, &clock));
+	if (adc_done != 0)
+		DES_CANDIDATE(DES_EV_ADC, adc_done);
+	if ((LCDCRA & _BV(LCDEN)) && (LCDCRA & _BV(LCDIE)))
+	{
+		des_time_t p = lcd_frame();
+		DES_CANDIDATE(DES_EV_LCD, (lcd_cleared/p + 1)*p);
+	}
+	if (eye_next != 0)
+		DES_CANDIDATE(DES_EV_EYE, eye_next);
+	if (keys_pos < keys_n)
+		DES_CANDIDATE(DES_EV_KEY, keys[keys_pos].t);
+	DES_CANDIDATE(DES_EV_RFM, rfm12_next());
+
+#undef DES_CANDIDATE
+
+	next_time = *when = best;
+	return next_ev = ev;
+}
+
+static void des_pin_change(uint8_t changed, uint8_t mask, des_irq_t irq)
+{
+	if (changed & mask)
+		des_pending |= _BV(irq);
+}
+
+/*!
+ *******************************************************************************
+ *  let event \a ev happen, time has already been advanced
+ ******************************************************************************/
+static void des_fire(int ev, des_time_t when)
+{
+	uint64_t clock;
+
+	des_changed();
+	switch (ev)
+	{
+		case DES_EV_T2OVF:
+			timer_next(&t2, t2.done_ovf, 0, &clock);
+			t2.done_ovf = clock;
+			des_pending |= _BV(DES_IRQ_T2OVF);
+			break;
+
+		case DES_EV_T2COMP:
+			timer_next(&t2, t2.done_cmp, t2.ocr+1, &clock);
+			t2.done_cmp = clock;
+			des_pending |= _BV(DES_IRQ_T2COMP);
+			break;
+
+		case DES_EV_T0OVF:
+			timer_next(&t0, t0.done_ovf, 0, &clock);
+			t0.done_ovf = clock;
+			des_pending |= _BV(DES_IRQ_T0OVF);
+			break;
+
+		case DES_EV_ADC:
+			hal_adc_convert();
+			adc_done = 0;
+			des_stats.adc_conversions++;
+			des_pending |= _BV(DES_IRQ_ADC);
+			break;
+
+		case DES_EV_LCD:
+			lcd_cleared = des_now;  // frames missed while disabled set the flag only once
+			des_pending |= _BV(DES_IRQ_LCD);
+			break;
+
+		case DES_EV_EYE:
+		{
+			uint8_t pine = PINE;
+			des_time_t period = (des_time_t)des_motor_period*DES_SECOND/1000000;
+
+			if (!eye_high)
+			{
+				int16_t pos = des_motor_pos + motor_dir;
+				if (pos < 0 || pos > des_motor_stroke)
+				{
+					eye_next = 0;   // end stop, the motor stalls
+					break;
+				}
+				des_motor_pos = pos;
+				des_stats.motor_impulses++;
+				eye_high = true;
+				eye_next = when + period*3/10;
+			}
+			else
+			{
+				eye_high = false;
+				eye_next = when + period - period*3/10;
+			}
+			if (eye_high && (PORTE & _BV(PE2)))
+				PINE |= _BV(PE1);
+			else
+				PINE &= (uint8_t)~_BV(PE1);
+			des_pin_change(pine ^ PINE, PCMSK0, DES_IRQ_PCINT0);
+			break;
+		}
+
+		case DES_EV_KEY:
+		{
+			uint8_t pinb = PINB;
+			PINB = keys[keys_pos++].pinb;
+			des_pin_change(pinb ^ PINB, PCMSK1, DES_IRQ_PCINT1);
+			break;
+		}
+
+		case DES_EV_RFM:
+		{
+			uint8_t pine = PINE;
+			rfm12_fire();
+			des_pin_change(pine ^ PINE, PCMSK0, DES_IRQ_PCINT0);
+			break;
+		}
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  execute pending and enabled interrupts in priority order
+ *
+ *  \returns true if at least one ISR was executed
+ ******************************************************************************/
+static bool des_service(void)
+{
+	bool any = false;
+	des_irq_t irq;
+	uint8_t pend;
+
+	while ((pend = des_pending & irq_enabled()) != 0)
+	{
+		for (irq=0; !(pend & _BV(irq)); irq++)
+			;
+		des_pending &= ~_BV(irq);
+		if (irq == DES_IRQ_LCD)
+			lcd_cleared = des_now;
+		des_regs_out();
+		irq_call(irq);
+		des_stats.irq[irq]++;
+		des_busy(des_cost_irq[irq]);
+		des_sync();
+		any = true;
+	}
+	return any;
+}
+
+/*!
+ *******************************************************************************
+ *  handle every event up to now, including the ones caused by busy time
+ ******************************************************************************/
+static bool des_catch_up(void)
+{
+	bool woke = false;
+	des_time_t t;
+	int ev;
+
+	for (;;)
+	{
+		while ((ev = des_next(&t)) >= 0 && t <= des_now)
+			des_fire(ev, t);
+		if (!des_service())
+			return woke;
+		woke = true;
+	}
+}
+
+static des_mode_t des_mode(void)
+{
+	switch (SMCR & (_BV(SM0) | _BV(SM1) | _BV(SM2)))
+	{
+		case 0:                         return DES_MODE_IDLE;
+		case _BV(SM0):                  return DES_MODE_ADC_NR;
+		case _BV(SM1):                  return DES_MODE_PWR_DOWN;
+		case _BV(SM0) | _BV(SM1):       return DES_MODE_PWR_SAVE;
+		default:                        return DES_MODE_PWR_SAVE;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  sleep instruction of the firmware
+ *
+ *  Charges the main loop pass that ends here, then jumps from event to
+ *  event until one of them wakes the CPU.
+ ******************************************************************************/
+static void des_sleep(void)
+{
+	des_mode_t mode = des_mode();
+	uint32_t cost = des_cost_loop;
+	uint8_t i;
+
+	for (i=0; i<8; i++)
+		if (des_wake_task & _BV(i))
+			cost += des_cost_task[i];
+	if (des_wake_task & (TASK_RTC | TASK_KB))
+		cost += des_cost_display;
+	#if EVENT_CONTROLLER
+	{
+		// TASK_RTC is charged with a full CTL_update pass
+		uint8_t skipped = CTL_skip_count - des_ctl_skip_count;
+		des_ctl_skip_count = CTL_skip_count;
+		des_stats.ctl_skipped += skipped;
+		if (des_cost_ctl > des_cost_ctl_skip)
+			cost -= (uint32_t)skipped * (des_cost_ctl - des_cost_ctl_skip);
+	}
+	#endif
+	#if ADC_ADAPTIVE
+	{
+		// the skipped second runs no TASK_ADC, the rings are fed in TASK_RTC
+		uint8_t skipped = ADC_skip_count - des_adc_skip_count;
+		des_adc_skip_count = ADC_skip_count;
+		des_stats.adc_skipped += skipped;
+		cost += (uint32_t)skipped * des_cost_adc_hold;
+	}
+	#endif
+	des_busy(cost);
+	des_sync();
+
+	if (!des_catch_up())
+	{
+		for (;;)
+		{
+			des_time_t t;
+			int ev = des_next(&t);
+
+			if (des_wait_hook != NULL && des_wait_hook((ev >= 0 && t < des_end) ? t : des_end))
+			{
+				des_changed();      // a frame has come on the air
+				continue;
+			}
+			if (ev < 0 || t >= des_end)
+			{
+				des_stats.time[mode] += des_end - des_now;
+				des_now = des_end;
+				longjmp(des_exit, 1);
+			}
+			des_stats.time[mode] += t - des_now;
+			des_now = t;
+			des_fire(ev, t);
+			if (des_catch_up())
+				break;
+		}
+	}
+	des_stats.wakeups++;
+	des_wake_task = task;
+	des_regs_out();
+}
+
+/*!
+ *******************************************************************************
+ *  add a key state change, \a pinb is the new level of port B (low active)
+ ******************************************************************************/
+void des_key(des_time_t t, uint8_t pinb)
+{
+	unsigned i;
+
+	keys = realloc(keys, (keys_n+1)*sizeof(*keys));
+	for (i=keys_n; i>0 && keys[i-1].t > t; i--)
+		keys[i] = keys[i-1];
+	keys[i].t = t;
+	keys[i].pinb = pinb;
+	keys_n++;
+}
+
+/*!
+ *******************************************************************************
+ *  read "<name> <cycles>" lines overriding the cost table
+ ******************************************************************************/
+bool des_cost_load(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	char name[32];
+	unsigned cycles;
+	bool ok = true;
+
+	if (f == NULL)
+		return false;
+	while (fscanf(f, " %31s %u", name, &cycles) == 2)
+	{
+		uint8_t i;
+		bool found = false;
+
+		for (i=0; i<DES_IRQS; i++)
+			if (strcmp(name, des_irq_name[i]) == 0)
+				des_cost_irq[i] = cycles, found = true;
+		for (i=0; i<8; i++)
+			if (strcmp(name, des_task_name[i]) == 0)
+				des_cost_task[i] = cycles, found = true;
+		if (strcmp(name, "loop") == 0)
+			des_cost_loop = cycles, found = true;
+		if (strcmp(name, "display") == 0)
+			des_cost_display = cycles, found = true;
+		if (strcmp(name, "controller") == 0)
+			des_cost_ctl = cycles, found = true;
+		if (strcmp(name, "controller-skip") == 0)
+			des_cost_ctl_skip = cycles, found = true;
+		if (strcmp(name, "adc-hold") == 0)
+			des_cost_adc_hold = cycles, found = true;
+		if (!found)
+		{
+			fprintf(stderr, "%s: unknown cost entry %s\n", path, name);
+			ok = false;
+		}
+	}
+	fclose(f);
+	return ok;
+}
+
+/*!
+ *******************************************************************************
+ *  run the firmware from reset for \a duration
+ ******************************************************************************/
+void des_run(des_time_t duration)
+{
+	des_now = 0;
+	des_end = duration;
+	keys_pos = 0;
+	memset(&des_stats, 0, sizeof(des_stats));
+	#if EVENT_CONTROLLER
+	des_ctl_skip_count = CTL_skip_count;
+	#endif
+	#if ADC_ADAPTIVE
+	des_adc_skip_count = ADC_skip_count;
+	#endif
+	rfm_state = DES_RFM_XTAL;       // RFM12 power-on default
+	rfm_since = 0;
+	hal_sleep_hook = des_sleep;
+	hal_rfm_hook = des_rfm;
+	hal_rfm_device = rfm12_spi16;
+	rfm12_reset();
+	des_regs_out();
+	des_changed();
+
+	if (setjmp(des_exit) == 0)
+		firmware_main();
+
+	motor_account();
+	if (motor_dir != 0)
+		des_stats.motor_time += des_now - motor_since;
+	des_stats.rfm_time[rfm_state] += des_now - rfm_since;
+	hal_sleep_hook = NULL;
+	hal_rfm_hook = NULL;
+	hal_rfm_device = NULL;
+}
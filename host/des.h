@@ -0,0 +1,134 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/des.h
+ * \brief      discrete-event simulation of the firmware main loop
+ *
+ * The unmodified main() of main.c runs on the host. Every time it executes
+ * the sleep instruction the simulator computes from the peripheral
+ * registers when the next interrupt would fire (timer2 overflow and compare,
+ * timer0 overflow, ADC, LCD frame, pin changes of the motor eye, keys and
+ * RFM12 SDO), jumps straight to that point in time and calls the ISR. CPU
+ * time spent between wake-up and the next sleep is taken from a cycle cost
+ * table. The radio chip is modelled in rfm12.c.
+ *
+ * Time unit is 1/128 CPU cycle at 4 MHz, one 32.768 kHz tick is exactly
+ * \ref DES_TICK32K units.
+ *
+ * The speed is bound by the firmware code that runs for real: the display
+ * is redrawn every second (about 85 segment writes) and takes more than half
+ * of the wall time. One core of the build machine runs some 650 to 950
+ * device-days per wall minute, without the display the limit would be about
+ * twice that.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "config.h"
+
+typedef uint64_t des_time_t;
+
+#define DES_CYCLE       128ULL                  //!< one CPU cycle
+#define DES_TICK32K     15625ULL                //!< one 32.768 kHz period
+#define DES_SECOND      (4000000ULL*DES_CYCLE)  //!< one second
+
+//! interrupt sources in AVR vector order (= priority)
+typedef enum {
+	DES_IRQ_PCINT0,
+	DES_IRQ_PCINT1,
+	DES_IRQ_T2COMP,
+	DES_IRQ_T2OVF,
+	DES_IRQ_T0OVF,
+	DES_IRQ_ADC,
+	DES_IRQ_LCD,
+	DES_IRQS
+} des_irq_t;
+
+//! how the sleeping CPU spent its time
+typedef enum {
+	DES_MODE_ACTIVE,
+	DES_MODE_IDLE,
+	DES_MODE_ADC_NR,
+	DES_MODE_PWR_SAVE,
+	DES_MODE_PWR_DOWN,
+	DES_MODES
+} des_mode_t;
+
+//! RFM12 state selected by the last power management command
+typedef enum {
+	DES_RFM_SLEEP,
+	DES_RFM_XTAL,      //!< crystal oscillator only
+	DES_RFM_SYNTH,     //!< synthesizer locked, transmitter warm-up
+	DES_RFM_RX,
+	DES_RFM_TX,
+	DES_RFM_STATES
+} des_rfm_t;
+
+typedef struct {
+	des_time_t time[DES_MODES];    //!< accumulated time per mode
+	uint64_t wakeups;              //!< number of sleep instructions left
+	uint64_t irq[DES_IRQS];        //!< executed interrupt service routines
+	uint64_t adc_conversions;
+	des_time_t motor_time;         //!< H-bridge driven
+	uint64_t motor_impulses;       //!< eye impulses generated by the model
+	double motor_charge;           //!< curr_average integrated over motor_time [mA s]
+	des_time_t rfm_time[DES_RFM_STATES];
+	uint64_t ctl_skipped;          //!< CTL_update calls without a full pass (EVENT_CONTROLLER)
+	uint64_t adc_skipped;          //!< seconds without ADC sequence (ADC_ADAPTIVE)
+} des_stats_t;
+
+extern des_stats_t des_stats;
+extern des_time_t des_now;
+
+extern const char * const des_irq_name[DES_IRQS];
+extern const char * const des_mode_name[DES_MODES];
+extern const char * const des_rfm_name[DES_RFM_STATES];
+
+//! cycle cost of the ISRs in \ref des_irq_t order
+extern uint16_t des_cost_irq[DES_IRQS];
+//! cycle cost of the main loop tasks, index is the bit number in "task"
+extern uint16_t des_cost_task[8];
+extern uint16_t des_cost_loop;     //!< main loop pass, sleep entry and wake-up
+extern uint16_t des_cost_display;  //!< menu_view() after RTC or key task
+extern uint16_t des_cost_ctl;      //!< full CTL_update pass without PID, part of TASK_RTC
+extern uint16_t des_cost_ctl_skip; //!< CTL_update that returns at once (EVENT_CONTROLLER)
+extern uint16_t des_cost_adc_hold; //!< skipped ADC second storing the last samples, part of TASK_RTC
+
+//! motor valve model
+extern int16_t des_motor_stroke;   //!< impulses between both end stops
+extern int16_t des_motor_pos;      //!< current position, 0 = closed
+extern uint32_t des_motor_period;  //!< eye impulse period [us]
+extern uint16_t des_motor_current; //!< H-bridge load current [mA]
+
+uint16_t des_motor_load(void);
+
+/*!
+ * real-time coupling: called before the simulation jumps ahead to \a t,
+ * returns true if it has changed the event sources (a radio frame came in)
+ */
+typedef bool (*des_wait_hook_t)(des_time_t t);
+
+extern des_wait_hook_t des_wait_hook;
+
+bool des_cost_load(const char *path);
+void des_key(des_time_t t, uint8_t pinb);
+void des_run(des_time_t duration);
@@ -0,0 +1,135 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/energy.c
+ * \brief      battery life estimate from the power states of a simulated run
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "des.h"
+#include "energy.h"
+
+/*
+ * Typical values at 3 V from the ATmega169V and RFM12 data sheets. Active
+ * and idle run from the 4 MHz RC oscillator, power-save keeps the 32 kHz
+ * timer 2 and the LCD driver in low power waveform running.
+ */
+energy_param_t energy_param = {
+	.cpu = {
+		2000,   // active
+		600,    // idle
+		350,    // adc-nr, ADC and its clock only
+		6,      // power-save
+		1,      // power-down
+	},
+	.rfm = {
+		0.3,    // sleep
+		620,    // crystal
+		2700,   // synthesizer
+		11000,  // receiver
+		23000,  // transmitter, full power
+	},
+	.base = 3,
+	.capacity = 2400,   // 2 alkaline AA cells down to bat_low_thld
+};
+
+/*!
+ *******************************************************************************
+ *  set one parameter from "name=value", names are the state names of
+ *  \ref des_mode_name and \ref des_rfm_name, "base" and "capacity"
+ ******************************************************************************/
+bool energy_param_set(const char *arg)
+{
+	const char *eq = strchr(arg, '=');
+	size_t len;
+	double v;
+	uint8_t i;
+
+	if (eq == NULL)
+		return false;
+	len = eq-arg;
+	v = atof(eq+1);
+	for (i=0; i<DES_MODES; i++)
+	{
+		if (strlen(des_mode_name[i]) == len && strncmp(arg, des_mode_name[i], len) == 0)
+		{
+			energy_param.cpu[i] = v;
+			return true;
+		}
+	}
+	for (i=0; i<DES_RFM_STATES; i++)
+	{
+		if (strlen(des_rfm_name[i]) == len && strncmp(arg, des_rfm_name[i], len) == 0)
+		{
+			energy_param.rfm[i] = v;
+			return true;
+		}
+	}
+	if (len == 4 && strncmp(arg, "base", 4) == 0)
+		energy_param.base = v;
+	else if (len == 8 && strncmp(arg, "capacity", 8) == 0)
+		energy_param.capacity = v;
+	else
+		return false;
+	return true;
+}
+
+static void energy_line(const char *name, double mas, double seconds, double total)
+{
+	printf("%-11s %12.3f mAs %8.2f uA %6.2f %%\n", name, mas, mas*1000/seconds,
+		(total > 0) ? 100*mas/total : 0);
+}
+
+/*!
+ *******************************************************************************
+ *  print the charge per state of the last des_run() of \a seconds
+ *
+ *  \returns projected battery life [days]
+ ******************************************************************************/
+double energy_report(double seconds)
+{
+	double cpu[DES_MODES], rfm[DES_RFM_STATES];
+	double base = energy_param.base*seconds/1000;
+	double total = base + des_stats.motor_charge;
+	double days;
+	uint8_t i;
+
+	for (i=0; i<DES_MODES; i++)
+		total += cpu[i] = energy_param.cpu[i]*des_stats.time[i]/DES_SECOND/1000;
+	for (i=0; i<DES_RFM_STATES; i++)
+		total += rfm[i] = energy_param.rfm[i]*des_stats.rfm_time[i]/DES_SECOND/1000;
+
+	for (i=0; i<DES_MODES; i++)
+		energy_line(des_mode_name[i], cpu[i], seconds, total);
+	for (i=0; i<DES_RFM_STATES; i++)
+		energy_line(des_rfm_name[i], rfm[i], seconds, total);
+	energy_line("motor", des_stats.motor_charge, seconds, total);
+	energy_line("base", base, seconds, total);
+
+	days = energy_param.capacity*3600/total*seconds/86400;
+	printf("average %.2f uA, %.0f mAh last %.0f days (%.1f years)\n",
+		total*1000/seconds, energy_param.capacity, days, days/365);
+	return days;
+}
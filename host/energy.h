@@ -0,0 +1,46 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/energy.h
+ * \brief      battery life estimate from the power states of a simulated run
+ *
+ * Charge is the time des_run() has accounted to every CPU sleep mode and
+ * RFM12 state multiplied by the supply current of that state, plus the
+ * motor charge the firmware has measured itself (curr_average) and a
+ * constant base load. The average current over the run projects the
+ * battery life.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "des.h"
+
+typedef struct {
+	double cpu[DES_MODES];          //!< ATmega169 supply current per mode [uA]
+	double rfm[DES_RFM_STATES];     //!< RFM12 supply current per state [uA]
+	double base;                    //!< LCD glass, dividers and leakage [uA]
+	double capacity;                //!< usable battery capacity [mAh]
+} energy_param_t;
+
+extern energy_param_t energy_param;
+
+bool energy_param_set(const char *arg);
+double energy_report(double seconds);
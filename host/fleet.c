@@ -0,0 +1,796 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/fleet.c
+ * \brief      radio network simulation of many slaves and their masters
+ *
+ * Up to 29 slaves per network and any number of networks share one radio
+ * channel. Every slave runs the timing of main.c and wireless.c on its own
+ * drifting clock: the transmit slot (wireless_tx_slot(), the same code
+ * the firmware uses), the sync windows with WL_SKIP_SYNC, the answer
+ * window after a transmission and the time_sync_tmo state machine with
+ * persistent receive while unsynchronized. The master sends a time sync
+ * every half minute. It forces extra slots for slaves with queued
+ * commands and answers every status packet, with the command if one is
+ * queued.
+ *
+ * Two packets that overlap on the channel are both lost, whatever
+ * network they belong to. Every remaining packet is lost with the
+ * probability "loss". A master is assumed to time its sync so that the
+ * slave clock is exact after it.
+ *
+ * Reported are collision and loss counts per packet type, latency from
+ * new status data to its reception by the master and from a queued
+ * command to the slave's answer, sync statistics and airtime per slave.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "config.h"
+#include "rtc.h"
+#include "wireless.h"
+#include "rfm_config.h"
+#include "rfm.h"
+
+#include "fleet.h"
+
+#define US              1e6                     //!< time unit is 1 us
+#define TICK            (US/256)                //!< RTC_s256
+#define FLEET_NODES     29
+#define FLEET_PREAMBLE  4                       //!< wl_header
+
+typedef struct {
+	double nodes;          //!< slaves per network
+	double networks;
+	double drift;          //!< clock tolerance of the slaves [+-ppm]
+	double loss;           //!< packet loss probability
+	double data;           //!< mean time between new status data [min]
+	double cmd;            //!< mean time between commands per slave [min], 0 = none
+	double payload;        //!< status bytes per packet
+	double cmd_bytes;      //!< command bytes in the master answer
+	double resp_bytes;     //!< answer of the slave to a command
+	double turnaround;     //!< master answer delay [ms]
+	double seed;
+	double detail;         //!< print a line per slave
+} fleet_param_t;
+
+static fleet_param_t param = {
+	.nodes = 29, .networks = 1, .drift = 50, .loss = 0.01,
+	.data = 10, .cmd = 60, .payload = 14, .cmd_bytes = 4, .resp_bytes = 8,
+	.turnaround = 5, .seed = 1, .detail = 0,
+};
+
+typedef enum { PKT_SYNC, PKT_UP, PKT_REPLY, PKT_RESP, PKT_TYPES } pkt_type_t;
+
+static const char * const pkt_name[PKT_TYPES] = { "sync", "status", "answer", "response" };
+
+typedef struct {
+	double start, end;
+	pkt_type_t type;
+	uint16_t net;
+	int16_t node;          //!< sender or receiver slave, -1 = broadcast
+	bool collided;
+	bool cmd;              //!< answer carries a command
+	double data_since;     //!< status data in the packet is that old
+	uint8_t force1, force2;
+	uint32_t flags;
+	bool plain;            //!< sync without forced slots
+} pkt_t;
+
+typedef enum { TMR_NONE, TMR_FIRST, TMR_RX_TMO, TMR_SYNC } tmr_t;
+
+typedef struct {
+	uint16_t net;
+	uint8_t addr;
+	double drift;          //!< relative to the master
+	double e0, t0;         //!< clock error e0 at true time t0
+	double next_tick;      //!< next local second
+	uint32_t tick_gen;
+	tmr_t tmr;
+	uint32_t tmr_gen;
+	int8_t time_sync_tmo;
+	uint8_t skip_sync;
+	uint8_t force1, force2;
+	uint32_t flags;
+	double rx_since;       //!< <0 receiver off
+	bool tx;
+	double data_since;     //!< <0 no data in the buffer
+	double counted_since;  //!< data already counted by the master
+	/* statistics */
+	double tx_time, rx_time;
+	uint32_t windows, synced, sync_losses;
+	uint32_t sent, collided;
+	double unsync_since, unsync_time;
+} node_t;
+
+typedef struct {
+	double offset;         //!< master clock - true time
+	double cmd_since[FLEET_NODES];  //!< <0 no command queued
+	double tx_until;
+} master_t;
+
+/* events */
+typedef enum { EV_TICK, EV_TIMER, EV_MASTER, EV_REPLY, EV_END, EV_DATA, EV_CMD } ev_type_t;
+
+typedef struct {
+	double t;
+	ev_type_t type;
+	uint16_t id;
+	uint32_t gen;
+	pkt_t *pkt;
+} event_t;
+
+static event_t *heap;
+static unsigned heap_n, heap_size;
+
+static node_t *node;
+static master_t *master;
+static unsigned nodes, networks;
+
+static pkt_t **air;
+static unsigned air_n;
+
+typedef struct {
+	double *v;
+	unsigned n, size;
+} latency_t;
+
+static struct {
+	uint64_t sent[PKT_TYPES], collided[PKT_TYPES], lost[PKT_TYPES];
+	latency_t data, cmd;
+	uint64_t dup_data, dup_cmd;
+} st;
+
+static uint64_t rnd_state;
+
+static double rnd(void)
+{
+	rnd_state ^= rnd_state >> 12;
+	rnd_state ^= rnd_state << 25;
+	rnd_state ^= rnd_state >> 27;
+	return ((rnd_state * 2685821657736338717ULL) >> 11) * (1.0/9007199254740992.0);
+}
+
+static double rnd_exp(double mean)
+{
+	return -mean*log(1 - rnd());
+}
+
+static void ev_push(double t, ev_type_t type, uint16_t id, uint32_t gen, pkt_t *pkt)
+{
+	unsigned i;
+
+	if (heap_n == heap_size)
+	{
+		heap_size = heap_size ? 2*heap_size : 256;
+		heap = realloc(heap, heap_size*sizeof(*heap));
+	}
+	for (i=heap_n++; i>0 && heap[(i-1)/2].t > t; i=(i-1)/2)
+		heap[i] = heap[(i-1)/2];
+	heap[i] = (event_t){ t, type, id, gen, pkt };
+}
+
+static event_t ev_pop(void)
+{
+	event_t top = heap[0], last = heap[--heap_n];
+	unsigned i = 0, c;
+
+	while ((c = 2*i+1) < heap_n)
+	{
+		if (c+1 < heap_n && heap[c+1].t < heap[c].t)
+			c++;
+		if (heap[c].t >= last.t)
+			break;
+		heap[i] = heap[c];
+		i = c;
+	}
+	heap[i] = last;
+	return top;
+}
+
+static void latency_add(latency_t *l, double v)
+{
+	if (l->n == l->size)
+	{
+		l->size = l->size ? 2*l->size : 1024;
+		l->v = realloc(l->v, l->size*sizeof(*l->v));
+	}
+	l->v[l->n++] = v;
+}
+
+/* clocks: local = true + master offset + e0 + drift*(true - t0) */
+
+static double node_local(const node_t *n, double t)
+{
+	return t + master[n->net].offset + n->e0 + n->drift*(t - n->t0);
+}
+
+static double node_true(const node_t *n, double local)
+{
+	return (local - master[n->net].offset - n->e0 + n->drift*n->t0)/(1 + n->drift);
+}
+
+static double air_time(unsigned bytes)
+{
+	return (FLEET_PREAMBLE + bytes)*8*US/RFM_BAUD_RATE;
+}
+
+/*!
+ *******************************************************************************
+ *  put a packet on the channel, everything it overlaps with is lost
+ ******************************************************************************/
+static pkt_t *channel_send(double t, pkt_type_t type, uint16_t net, int16_t nd, unsigned bytes)
+{
+	pkt_t *p = calloc(1, sizeof(*p));
+	unsigned i;
+
+	p->start = t;
+	p->end = t + air_time(bytes);
+	p->type = type;
+	p->net = net;
+	p->node = nd;
+	p->data_since = -1;
+	for (i=0; i<air_n; i++)
+	{
+		if (air[i]->end > p->start)
+		{
+			air[i]->collided = true;
+			p->collided = true;
+		}
+	}
+	air = realloc(air, (air_n+1)*sizeof(*air));
+	air[air_n++] = p;
+	st.sent[type]++;
+	ev_push(p->end, EV_END, 0, 0, p);
+	return p;
+}
+
+static bool received(const pkt_t *p)
+{
+	if (p->collided)
+		return false;
+	if (rnd() < param.loss)
+	{
+		st.lost[p->type]++;
+		return false;
+	}
+	return true;
+}
+
+static void rx_on(node_t *n, double t)
+{
+	if (n->rx_since < 0)
+		n->rx_since = t;
+}
+
+static void rx_off(node_t *n, double t)
+{
+	if (n->rx_since >= 0)
+		n->rx_time += t - n->rx_since;
+	n->rx_since = -1;
+}
+
+static bool rx_covers(const node_t *n, const pkt_t *p)
+{
+	return n->rx_since >= 0 && n->rx_since <= p->start;
+}
+
+static void timer_set(node_t *n, double t, tmr_t tmr)
+{
+	n->tmr = tmr;
+	n->tmr_gen++;
+	ev_push(t, EV_TIMER, n - node, n->tmr_gen, NULL);
+}
+
+static void timer_destroy(node_t *n)
+{
+	n->tmr = TMR_NONE;
+	n->tmr_gen++;
+}
+
+static void tick_schedule(node_t *n)
+{
+	n->tick_gen++;
+	ev_push(node_true(n, n->next_tick), EV_TICK, n - node, n->tick_gen, NULL);
+}
+
+static void sync_lost(node_t *n, double t, bool lost)
+{
+	if (lost && n->unsync_since < 0)
+	{
+		n->unsync_since = t;
+		n->sync_losses++;
+	}
+	else if (!lost && n->unsync_since >= 0)
+	{
+		n->unsync_time += t - n->unsync_since;
+		n->unsync_since = -1;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  slave transmits (wirelessSendPacket)
+ ******************************************************************************/
+static void node_send(node_t *n, double t, pkt_type_t type)
+{
+	unsigned bytes = (type == PKT_UP) ? param.payload + 12 : param.resp_bytes + 12;
+	pkt_t *p;
+
+	rx_off(n, t);
+	n->tx = true;
+	n->sent++;
+	p = channel_send(t, type, n->net, n - node, bytes);
+	p->data_since = n->data_since;
+	n->tx_time += p->end - p->start;
+	timer_destroy(n);
+}
+
+/*!
+ *******************************************************************************
+ *  wirelesTimeSyncCheck(), once a minute
+ ******************************************************************************/
+static void node_sync_check(node_t *n, double t)
+{
+	n->time_sync_tmo--;
+	if (n->time_sync_tmo <= 0)
+	{
+		if ((n->time_sync_tmo == 0) || (n->time_sync_tmo < -30))
+		{
+			n->time_sync_tmo = 0;
+			rx_on(n, t);
+		}
+		else if (n->time_sync_tmo < -4)
+		{
+			rx_off(n, t);
+			sync_lost(n, t, true);
+		}
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  one second of the slave's RTC (main.c, TASK_RTC)
+ ******************************************************************************/
+static void node_tick(node_t *n, double t)
+{
+	uint8_t sec = (uint64_t)llround(n->next_tick/US) % 60;
+
+	if (sec == 0)
+		node_sync_check(n, t);
+	if (n->time_sync_tmo > 1)
+	{
+		if (wireless_tx_slot(sec, n->addr, n->data_since >= 0, n->force1, n->force2, n->flags))
+			timer_set(n, node_true(n, n->next_tick + WLTIME_START*TICK), TMR_FIRST);
+		if ((sec == 59) || (sec == 29))
+		{
+			if (n->skip_sync != 0)
+				n->skip_sync--;
+			else
+				timer_set(n, node_true(n, n->next_tick + WLTIME_SYNC*TICK), TMR_SYNC);
+		}
+	}
+	n->next_tick += US;
+	tick_schedule(n);
+}
+
+/*!
+ *******************************************************************************
+ *  RTC_TIMER_RFM of the slave (wirelessTimer)
+ ******************************************************************************/
+static void node_timer(node_t *n, double t)
+{
+	switch (n->tmr)
+	{
+		case TMR_FIRST:
+			node_send(n, t, PKT_UP);
+			return;
+		case TMR_SYNC:
+			n->force1 = n->force2 = 0;
+			rx_on(n, t);
+			n->windows++;
+			timer_set(n, t + WLTIME_SYNC_TIMEOUT*TICK, TMR_RX_TMO);
+			return;
+		case TMR_RX_TMO:
+			if (!n->tx)
+				rx_off(n, t);
+			break;
+		default:
+			break;
+	}
+	n->tmr = TMR_NONE;
+}
+
+static void node_got_sync(node_t *n, const pkt_t *p, double t)
+{
+	rx_off(n, t);
+	timer_destroy(n);
+	n->force1 = p->force1;
+	n->force2 = p->force2;
+	n->flags = p->flags;
+	if (p->plain)
+		n->skip_sync = WL_SKIP_SYNC;
+	n->time_sync_tmo = 20;
+	n->synced++;
+	sync_lost(n, t, false);
+
+	// clock is exact again, the second in progress is not repeated
+	n->e0 = 0;
+	n->t0 = t;
+	n->next_tick = floor(node_local(n, t)/US)*US + US;
+	tick_schedule(n);
+}
+
+static void node_got_reply(node_t *n, const pkt_t *p, double t)
+{
+	n->data_since = -1;            // wireless_buf_ptr = 0
+	timer_destroy(n);
+	if (p->cmd)
+		node_send(n, t, PKT_RESP);
+	else
+		rx_off(n, t);
+}
+
+/*!
+ *******************************************************************************
+ *  master: time sync every half minute, forced slots for queued commands
+ ******************************************************************************/
+static void master_sync(uint16_t net, double t)
+{
+	master_t *m = &master[net];
+	uint8_t pending[FLEET_NODES], n = 0, i, bytes;
+	uint32_t flags = 0;
+	pkt_t *p;
+
+	for (i=0; i<nodes; i++)
+	{
+		if (m->cmd_since[i] >= 0)
+		{
+			pending[n++] = node[net*nodes + i].addr;
+			flags |= 1UL << node[net*nodes + i].addr;
+		}
+	}
+	bytes = (n == 0) ? 9 : (n <= 2) ? 11 : 13;
+	p = channel_send(t, PKT_SYNC, net, -1, bytes + 2);
+	m->tx_until = p->end;
+	p->plain = (n == 0);
+	if (n > 2)
+	{
+		p->force1 = 0xff;
+		p->flags = flags;
+	}
+	else if (n > 0)
+	{
+		p->force1 = pending[0];
+		p->force2 = (n > 1) ? pending[1] : 0;
+	}
+	ev_push(t + 30*US, EV_MASTER, net, 0, NULL);
+}
+
+static void master_reply(pkt_t *up, double t)
+{
+	master_t *m = &master[up->net];
+	unsigned idx = up->node - up->net*nodes;
+	bool cmd = m->cmd_since[idx] >= 0;
+	pkt_t *p;
+
+	p = channel_send(t, PKT_REPLY, up->net, up->node, 8 + (cmd ? param.cmd_bytes : 0));
+	p->cmd = cmd;
+	m->tx_until = p->end;
+}
+
+/*!
+ *******************************************************************************
+ *  end of a packet: deliver it
+ ******************************************************************************/
+static void packet_end(pkt_t *p, double t)
+{
+	unsigned i;
+
+	for (i=0; i<air_n; i++)
+	{
+		if (air[i] == p)
+		{
+			air[i] = air[--air_n];
+			break;
+		}
+	}
+	if (p->collided)
+		st.collided[p->type]++;
+
+	if (p->type == PKT_SYNC)
+	{
+		for (i=0; i<nodes; i++)
+		{
+			node_t *n = &node[p->net*nodes + i];
+
+			if (rx_covers(n, p) && received(p))
+				node_got_sync(n, p, t);
+		}
+	}
+	else if (p->type == PKT_REPLY)
+	{
+		node_t *n = &node[p->node];
+
+		if (rx_covers(n, p) && received(p))
+			node_got_reply(n, p, t);
+	}
+	else
+	{
+		node_t *n = &node[p->node];
+		master_t *m = &master[p->net];
+		unsigned idx = p->node - p->net*nodes;
+
+		n->tx = false;
+		if (p->collided)
+			n->collided++;
+		// wirelessSendDone(): wait for the answer
+		rx_on(n, t);
+		timer_set(n, t + WLTIME_TIMEOUT*TICK, TMR_RX_TMO);
+
+		if (received(p))
+		{
+			if (p->type == PKT_UP)
+			{
+				if (p->data_since >= 0)
+				{
+					if (p->data_since != n->counted_since)
+					{
+						latency_add(&st.data, t - p->data_since);
+						n->counted_since = p->data_since;
+					}
+					else
+						st.dup_data++;
+				}
+				ev_push(t + param.turnaround*1000, EV_REPLY, 0, 0, p);
+				return;     // the answer still needs the packet
+			}
+			if (m->cmd_since[idx] >= 0)
+			{
+				latency_add(&st.cmd, t - m->cmd_since[idx]);
+				m->cmd_since[idx] = -1;
+			}
+			else
+				st.dup_cmd++;
+		}
+	}
+	free(p);
+}
+
+/*!
+ *******************************************************************************
+ *  -f name=value, change one fleet parameter
+ ******************************************************************************/
+bool fleet_param(const char *arg)
+{
+	static const struct {
+		const char *name;
+		size_t offset;
+	} names[] = {
+		{ "nodes", offsetof(fleet_param_t, nodes) },
+		{ "networks", offsetof(fleet_param_t, networks) },
+		{ "drift", offsetof(fleet_param_t, drift) },
+		{ "loss", offsetof(fleet_param_t, loss) },
+		{ "data", offsetof(fleet_param_t, data) },
+		{ "cmd", offsetof(fleet_param_t, cmd) },
+		{ "payload", offsetof(fleet_param_t, payload) },
+		{ "cmd_bytes", offsetof(fleet_param_t, cmd_bytes) },
+		{ "resp_bytes", offsetof(fleet_param_t, resp_bytes) },
+		{ "turnaround", offsetof(fleet_param_t, turnaround) },
+		{ "seed", offsetof(fleet_param_t, seed) },
+		{ "detail", offsetof(fleet_param_t, detail) },
+	};
+	const char *eq = strchr(arg, '=');
+	uint8_t i;
+
+	if (eq == NULL)
+		return false;
+	for (i=0; i<sizeof(names)/sizeof(names[0]); i++)
+	{
+		if (strlen(names[i].name) == (size_t)(eq-arg) && strncmp(arg, names[i].name, eq-arg) == 0)
+		{
+			*(double *)((char *)&param + names[i].offset) = atof(eq+1);
+			return true;
+		}
+	}
+	return false;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+static void latency_print(const char *name, latency_t *l)
+{
+	double sum = 0;
+	unsigned i;
+
+	if (l->n == 0)
+	{
+		printf("%-9s latency: nothing delivered\n", name);
+		return;
+	}
+	qsort(l->v, l->n, sizeof(*l->v), cmp_double);
+	for (i=0; i<l->n; i++)
+		sum += l->v[i];
+	printf("%-9s latency: %u delivered, mean %.1f s, p95 %.1f s, max %.1f s\n", name, l->n,
+		sum/l->n/US, l->v[(unsigned)(0.95*(l->n-1))]/US, l->v[l->n-1]/US);
+}
+
+/*!
+ *******************************************************************************
+ *  simulate \a days and print the report
+ ******************************************************************************/
+int fleet_run(double days)
+{
+	double end = days*86400*US;
+	uint64_t sent = 0, lost = 0;
+	unsigned i, k, pending_data = 0, pending_cmd = 0;
+	double tx_max = 0, rx_max = 0, tx_sum = 0, rx_sum = 0, unsync = 0;
+	uint32_t windows = 0, synced = 0, losses = 0;
+
+	nodes = (unsigned)param.nodes;
+	networks = (unsigned)param.networks;
+	if (nodes < 1 || nodes > FLEET_NODES || networks < 1 || days <= 0)
+	{
+		fprintf(stderr, "fleet: 1..%u nodes per network\n", FLEET_NODES);
+		return 2;
+	}
+	rnd_state = 0x9e3779b97f4a7c15ULL * ((uint64_t)param.seed + 1);
+
+	master = calloc(networks, sizeof(*master));
+	node = calloc(networks*nodes, sizeof(*node));
+	for (k=0; k<networks; k++)
+	{
+		master_t *m = &master[k];
+
+		// independent networks are not aligned to each other
+		m->offset = (k == 0) ? 0 : floor(rnd()*30*US);
+		for (i=0; i<nodes; i++)
+			m->cmd_since[i] = -1;
+		ev_push(30*US - fmod(m->offset, 30*US), EV_MASTER, k, 0, NULL);
+
+		for (i=0; i<nodes; i++)
+		{
+			node_t *n = &node[k*nodes + i];
+
+			n->net = k;
+			n->addr = i + 1;
+			n->drift = (2*rnd() - 1)*param.drift*1e-6;
+			n->e0 = floor(rnd()*60*US);     // powered on at any time
+			n->rx_since = -1;
+			n->data_since = -1;
+			n->counted_since = -1;
+			n->unsync_since = 0;
+			rx_on(n, 0);                    // persistent RX for initial sync
+			n->next_tick = ceil(node_local(n, 0)/US)*US;
+			tick_schedule(n);
+			ev_push(rnd_exp(param.data*60*US), EV_DATA, n - node, 0, NULL);
+			if (param.cmd > 0)
+				ev_push(rnd_exp(param.cmd*60*US), EV_CMD, n - node, 0, NULL);
+		}
+	}
+
+	while (heap_n > 0 && heap[0].t < end)
+	{
+		event_t ev = ev_pop();
+		node_t *n = &node[ev.id];
+
+		switch (ev.type)
+		{
+			case EV_TICK:
+				if (ev.gen == n->tick_gen)
+					node_tick(n, ev.t);
+				break;
+			case EV_TIMER:
+				if (ev.gen == n->tmr_gen)
+					node_timer(n, ev.t);
+				break;
+			case EV_MASTER:
+				master_sync(ev.id, ev.t);
+				break;
+			case EV_REPLY:
+				master_reply(ev.pkt, ev.t);
+				free(ev.pkt);
+				break;
+			case EV_END:
+				packet_end(ev.pkt, ev.t);
+				break;
+			case EV_DATA:
+				if (n->data_since < 0)
+					n->data_since = ev.t;
+				ev_push(ev.t + rnd_exp(param.data*60*US), EV_DATA, ev.id, 0, NULL);
+				break;
+			case EV_CMD:
+			{
+				master_t *m = &master[n->net];
+				if (m->cmd_since[ev.id - n->net*nodes] < 0)
+					m->cmd_since[ev.id - n->net*nodes] = ev.t;
+				ev_push(ev.t + rnd_exp(param.cmd*60*US), EV_CMD, ev.id, 0, NULL);
+				break;
+			}
+		}
+	}
+
+	printf("%u network(s) x %u slaves, %.1f days, drift +-%.0f ppm, loss %.1f %%\n",
+		networks, nodes, days, param.drift, param.loss*100);
+	printf("%-9s %10s %10s %10s\n", "packets", "sent", "collided", "lost");
+	for (i=0; i<PKT_TYPES; i++)
+	{
+		printf("%-9s %10llu %10llu %10llu\n", pkt_name[i], (unsigned long long)st.sent[i],
+			(unsigned long long)st.collided[i], (unsigned long long)st.lost[i]);
+		if (i != PKT_SYNC)
+		{
+			sent += st.sent[i];
+			lost += st.collided[i];
+		}
+	}
+	printf("collision rate %.3f %% of slave and answer packets\n", sent ? 100.0*lost/sent : 0);
+
+	for (i=0; i<networks*nodes; i++)
+	{
+		node_t *n = &node[i];
+
+		rx_off(n, end);
+		sync_lost(n, end, false);
+		tx_sum += n->tx_time;
+		rx_sum += n->rx_time;
+		if (n->tx_time > tx_max)
+			tx_max = n->tx_time;
+		if (n->rx_time > rx_max)
+			rx_max = n->rx_time;
+		windows += n->windows;
+		synced += n->synced;
+		losses += n->sync_losses;
+		unsync += n->unsync_time;
+		pending_data += (n->data_since >= 0);
+		pending_cmd += (master[n->net].cmd_since[i - n->net*nodes] >= 0);
+	}
+	latency_print("status", &st.data);
+	printf("          %llu duplicates, %u still queued\n", (unsigned long long)st.dup_data, pending_data);
+	latency_print("command", &st.cmd);
+	printf("          %llu duplicates, %u still queued\n", (unsigned long long)st.dup_cmd, pending_cmd);
+	printf("sync: %u windows, %u syncs received, %u sync losses, unsynchronized %.2f %% of the time\n",
+		windows, synced, losses, 100*unsync/(end*networks*nodes));
+	printf("airtime per slave and day: TX mean %.2f s max %.2f s, RX mean %.1f s max %.1f s\n",
+		tx_sum/(networks*nodes)/days/US, tx_max/days/US,
+		rx_sum/(networks*nodes)/days/US, rx_max/days/US);
+
+	if (param.detail != 0)
+	{
+		printf("%4s %4s %10s %10s %8s %8s %8s %8s\n", "net", "addr", "TX s/day", "RX s/day",
+			"sent", "collided", "windows", "synced");
+		for (i=0; i<networks*nodes; i++)
+		{
+			node_t *n = &node[i];
+			printf("%4u %4u %10.2f %10.1f %8u %8u %8u %8u\n", n->net, n->addr,
+				n->tx_time/days/US, n->rx_time/days/US, n->sent, n->collided,
+				n->windows, n->synced);
+		}
+	}
+	return 0;
+}
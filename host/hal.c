@@ -0,0 +1,202 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), hardware abstraction
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/hal.c
+ * \brief      register and peripheral emulation for the host build
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "config.h"
+#include "motor.h"
+#include "hal.h"
+
+#undef EEDR
+#undef EECR
+
+#define HAL_DEF8(r) volatile uint8_t r;
+#define HAL_DEF16(r) volatile uint16_t r;
+
+HAL_DEF8(PINA) HAL_DEF8(DDRA) HAL_DEF8(PORTA)
+HAL_DEF8(PINB) HAL_DEF8(DDRB) HAL_DEF8(PORTB)
+HAL_DEF8(PINC) HAL_DEF8(DDRC) HAL_DEF8(PORTC)
+HAL_DEF8(PIND) HAL_DEF8(DDRD) HAL_DEF8(PORTD)
+HAL_DEF8(PINE) HAL_DEF8(DDRE) HAL_DEF8(PORTE)
+HAL_DEF8(PINF) HAL_DEF8(DDRF) HAL_DEF8(PORTF)
+HAL_DEF8(PING) HAL_DEF8(DDRG) HAL_DEF8(PORTG)
+
+HAL_DEF8(GPIOR0) HAL_DEF8(GPIOR1) HAL_DEF8(GPIOR2)
+HAL_DEF8(SREG) HAL_DEF8(MCUCR) HAL_DEF8(MCUSR) HAL_DEF8(SMCR)
+HAL_DEF8(CLKPR) HAL_DEF8(OSCCAL) HAL_DEF8(PRR)
+HAL_DEF8(EIMSK) HAL_DEF8(EIFR) HAL_DEF8(PCMSK0) HAL_DEF8(PCMSK1)
+HAL_DEF8(ACSR) HAL_DEF8(DIDR0) HAL_DEF8(DIDR1)
+HAL_DEF8(ADMUX) HAL_DEF8(ADCSRA) HAL_DEF8(ADCSRB) HAL_DEF16(ADCW)
+HAL_DEF8(GTCCR)
+HAL_DEF8(TCCR0A) HAL_DEF8(TCNT0) HAL_DEF8(OCR0A) HAL_DEF8(TIMSK0) HAL_DEF8(TIFR0)
+HAL_DEF8(TCCR2A) HAL_DEF8(TCNT2) HAL_DEF8(OCR2A) HAL_DEF8(TIMSK2) HAL_DEF8(TIFR2)
+HAL_DEF8(ASSR)
+HAL_DEF8(WDTCR)
+HAL_DEF8(LCDCRA) HAL_DEF8(LCDCRB) HAL_DEF8(LCDFRR) HAL_DEF8(LCDCCR)
+HAL_DEF8(LCDDR0) HAL_DEF8(LCDDR1) HAL_DEF8(LCDDR2) HAL_DEF8(LCDDR3)
+HAL_DEF8(LCDDR5) HAL_DEF8(LCDDR6) HAL_DEF8(LCDDR7) HAL_DEF8(LCDDR8)
+HAL_DEF8(LCDDR10) HAL_DEF8(LCDDR11) HAL_DEF8(LCDDR12) HAL_DEF8(LCDDR13)
+HAL_DEF8(LCDDR15) HAL_DEF8(LCDDR16) HAL_DEF8(LCDDR17) HAL_DEF8(LCDDR18)
+HAL_DEF16(EEAR)
+
+hal_adc_source_t hal_adc_source;
+uint32_t hal_ee_write_count;
+hal_sleep_hook_t hal_sleep_hook;
+hal_rfm_hook_t hal_rfm_hook;
+hal_rfm_device_t hal_rfm_device;
+
+/*
+ * EEPROM emulation
+ *
+ * All variables declared with the EEPROM attribute (eeprom.h) are placed in
+ * the "host_eeprom" data section, so the section is the EEPROM image and
+ * the linker symbols give its bounds. The firmware computes EEPROM addresses
+ * as (uint16_t)&variable, EEAR therefore holds the low 16 bits of a host
+ * pointer and the cell offset is the 16 bit difference to the section start.
+ */
+extern uint8_t __start_host_eeprom[];
+extern uint8_t __stop_host_eeprom[];
+
+static uint8_t ee_blank = 0xff;  //!< cell behind the end of the image
+static uint8_t ee_cr;
+
+uint16_t hal_eeprom_size(void)
+{
+	return (uint16_t)(__stop_host_eeprom - __start_host_eeprom);
+}
+
+uint8_t *hal_eeprom_image(void)
+{
+	return __start_host_eeprom;
+}
+
+volatile uint8_t *hal_eedr(void)
+{
+	uint16_t offset = (uint16_t)(EEAR - (uint16_t)(uintptr_t)__start_host_eeprom);
+
+	if (offset >= hal_eeprom_size())
+	{
+		ee_blank = 0xff;
+		return &ee_blank;
+	}
+	return &__start_host_eeprom[offset];
+}
+
+volatile uint8_t *hal_eecr(void)
+{
+	// EEDR is written directly, a write strobe only has to complete
+	if (ee_cr & _BV(EEWE))
+		hal_ee_write_count++;
+	ee_cr &= (uint8_t)~(_BV(EEWE) | _BV(EEMWE) | _BV(EERE));
+	return &ee_cr;
+}
+
+/*!
+ *******************************************************************************
+ *  power-on state of the emulated MCU
+ ******************************************************************************/
+void hal_init(void)
+{
+	SREG = 0;
+	PINB = 0xff;    // keys released (pull-ups)
+	PINE = 0;
+	ADMUX = 0;
+	ADCW = 0;
+	TCNT2 = 0;
+	ASSR = 0;       // asynchronous timer registers never busy
+	ee_cr = 0;
+	hal_ee_write_count = 0;
+}
+
+/*!
+ *******************************************************************************
+ *  finish one ADC conversion: load ADCW from the attached input model
+ ******************************************************************************/
+void hal_adc_convert(void)
+{
+	if (hal_adc_source != NULL)
+		ADCW = hal_adc_source(ADMUX & 0x1f) & 0x3ff;
+	ADCSRA &= (uint8_t)~_BV(ADSC);
+}
+
+#if MOTOR_COALESCE
+/*!
+ *******************************************************************************
+ *  motor without the eye model of the DES, calibrated to \a stroke
+ *  impulses and standing at \a pos
+ ******************************************************************************/
+void hal_motor_init(int16_t stroke, int16_t pos)
+{
+	MOTOR_calibration_step = 0;
+	MOTOR_PosMax = stroke;
+	MOTOR_PosAct = pos;
+}
+
+/*!
+ *******************************************************************************
+ *  valve request to MOTOR_Schedule(), a run it starts reaches its
+ *  position at once
+ *
+ *  \returns motor position [impulses]
+ ******************************************************************************/
+int16_t hal_motor_run(uint8_t percent)
+{
+	MOTOR_Schedule(percent);
+	if (MOTOR_run_test())
+	{
+		MOTOR_PosAct = (int16_t)MOTOR_sched_pos*(MOTOR_PosMax>>2)/(100>>2);
+		MOTOR_timer_stop();
+		MOTOR_eye_disable();
+	}
+	return MOTOR_PosAct;
+}
+#endif
+
+/*!
+ *******************************************************************************
+ *  sleep instruction, the simulator decides what happens until wake-up
+ ******************************************************************************/
+void hal_sleep(void)
+{
+	if (hal_sleep_hook != NULL)
+		hal_sleep_hook();
+}
+
+/*!
+ *******************************************************************************
+ *  RFM12 SPI command, the power management state is reported to
+ *  hal_rfm_hook, the word is answered by hal_rfm_device
+ *
+ *  \returns 0 without a device, status and FIFO of a radio that never
+ *  receives anything
+ ******************************************************************************/
+uint16_t hal_rfm_spi16(uint16_t outval)
+{
+	if ((outval & 0xff00) == 0x8200 && hal_rfm_hook != NULL)
+		hal_rfm_hook((uint8_t)outval);
+	return (hal_rfm_device != NULL) ? hal_rfm_device(outval) : 0;
+}
@@ -0,0 +1,63 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), hardware abstraction
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/hal.h
+ * \brief      register and peripheral emulation for the host build
+ *
+ * The firmware modules are compiled unchanged against the stub headers in
+ * host/avr/. This layer owns the register variables and the EEPROM image
+ * and lets a simulator feed the analog inputs.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/* ADC input: returns the raw 10 bit conversion result for ADMUX channel */
+typedef uint16_t (*hal_adc_source_t)(uint8_t mux);
+
+extern hal_adc_source_t hal_adc_source;
+extern uint32_t hal_ee_write_count; //!< completed EEPROM byte writes
+
+/* executed by the sleep instruction, NULL makes sleep a no-op */
+typedef void (*hal_sleep_hook_t)(void);
+
+extern hal_sleep_hook_t hal_sleep_hook;
+
+/* RFM12 power management command (low byte of 0x82xx) was sent */
+typedef void (*hal_rfm_hook_t)(uint8_t power);
+
+extern hal_rfm_hook_t hal_rfm_hook;
+
+/* RFM12 behind the SPI, returns the word clocked in, NULL = no radio */
+typedef uint16_t (*hal_rfm_device_t)(uint16_t outval);
+
+extern hal_rfm_device_t hal_rfm_device;
+
+void hal_init(void);
+void hal_adc_convert(void);
+void hal_sleep(void);
+uint16_t hal_rfm_spi16(uint16_t outval);
+uint16_t hal_eeprom_size(void);
+uint8_t *hal_eeprom_image(void);
+#if MOTOR_COALESCE
+void hal_motor_init(int16_t stroke, int16_t pos);
+int16_t hal_motor_run(uint8_t percent);
+#endif
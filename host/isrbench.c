@@ -0,0 +1,389 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc, libsimavr)
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/isrbench.c
+ * \brief      cycle-accurate ISR benchmark of the firmware ELF in simavr
+ *
+ * The real firmware image runs in the simavr instruction simulator with a
+ * stimulus on the interrupt pins: the motor photo eye on PE1, the RFM12
+ * SDO (FIFO fill level) on PE6 at the byte rate of the radio and key
+ * presses on port B. Every interrupt vector is timed from the pending flag
+ * to the vector fetch (latency) and from there to its reti (cycles).
+ *
+ * The report is JSON. With a limit file (isrbench.lim) every vector with
+ * a limit is checked and the exit code is 1 if one is exceeded. Vectors
+ * the stimulus never reaches are reported with count 0 and fail their
+ * limit, an unmeasured ISR must not pass silently.
+ *
+ * -F times calls of a firmware function from its entry address (avr-nm)
+ * until the stack pointer is back above the return address. Cycles of
+ * interrupts in between are not counted, two firmware builds can be
+ * compared by the "functions" part of their reports.
+ *
+ * usage: Zero_isrbench [-m mcu] [-f hz] [-t seconds] [-b baud]
+ *                      [-l limitfile] [-o report] [-F name@address]
+ *                      firmware.elf
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_interrupts.h"
+#include "sim_cycle_timers.h"
+#include "avr_ioport.h"
+
+#define VECTORS         23      //!< ATmega169 including reset
+#define VECTOR_PCINT0   2       //!< motor eye and RFM12 SDO
+
+static const char * const vector_name[VECTORS] = {
+	"RESET", "INT0_vect", "PCINT0_vect", "PCINT1_vect",
+	"TIMER2_COMP_vect", "TIMER2_OVF_vect", "TIMER1_CAPT_vect",
+	"TIMER1_COMPA_vect", "TIMER1_COMPB_vect", "TIMER1_OVF_vect",
+	"TIMER0_COMP_vect", "TIMER0_OVF_vect", "SPI_STC_vect",
+	"USART0_RX_vect", "USART0_UDRE_vect", "USART0_TX_vect",
+	"USI_START_vect", "USI_OVERFLOW_vect", "ANALOG_COMP_vect",
+	"ADC_vect", "EE_READY_vect", "SPM_READY_vect", "LCD_vect",
+};
+
+typedef struct {
+	uint64_t count;
+	uint64_t sum;
+	uint32_t max;              //!< longest ISR [cycles]
+	uint32_t latency_max;      //!< longest pending to vector fetch [cycles]
+	avr_cycle_count_t pending; //!< flag raised at, 0 = not pending
+	avr_cycle_count_t entry;   //!< vector fetched at, 0 = not running
+	long limit;                //!< max cycles, <0 = none
+	long latency_limit;
+} isr_stat_t;
+
+static isr_stat_t stat[VECTORS];
+static avr_t *avr;
+static uint64_t isr_cycles;        //!< all ISR run time so far
+
+#define FUNCS           8
+
+typedef struct {
+	const char *name;
+	uint32_t addr;             //!< entry, byte address
+	uint64_t count;
+	uint64_t sum;
+	uint32_t max;              //!< longest call without ISRs [cycles]
+	avr_cycle_count_t entry;   //!< called at, 0 = not running
+	uint64_t entry_isr;        //!< isr_cycles at the call
+	uint16_t sp;               //!< stack pointer at the entry
+} func_stat_t;
+
+static func_stat_t func[FUNCS];
+static int funcs;
+
+/* stimulus */
+static uint32_t eye_period = 94000;     //!< photo eye [us], like a running motor
+static uint32_t byte_us;                //!< one radio byte [us]
+static uint32_t key_period = 2000000;   //!< key press every [us]
+
+static void isr_pending(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+	isr_stat_t *s = param;
+
+	if (value && s->pending == 0)
+		s->pending = avr->cycle;
+}
+
+static void isr_running(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+	isr_stat_t *s = param;
+
+	if (value)
+	{
+		s->entry = avr->cycle;
+		if (s->pending != 0 && s->entry - s->pending > s->latency_max)
+			s->latency_max = s->entry - s->pending;
+		s->pending = 0;
+	}
+	else if (s->entry != 0)
+	{
+		uint32_t c = avr->cycle - s->entry;
+
+		s->count++;
+		s->sum += c;
+		if (c > s->max)
+			s->max = c;
+		s->entry = 0;
+		isr_cycles += c;
+	}
+}
+
+static uint16_t avr_sp(void)
+{
+	return avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+}
+
+/*!
+ *******************************************************************************
+ *  after every instruction: entry and return of the -F functions
+ ******************************************************************************/
+static void func_step(void)
+{
+	int i;
+
+	for (i=0; i<funcs; i++)
+	{
+		func_stat_t *f = &func[i];
+
+		if (f->entry == 0)
+		{
+			if (avr->pc == f->addr)
+			{
+				f->entry = avr->cycle;
+				f->entry_isr = isr_cycles;
+				f->sp = avr_sp();
+			}
+		}
+		else if (avr_sp() > f->sp)
+		{
+			uint32_t c = avr->cycle - f->entry - (isr_cycles - f->entry_isr);
+
+			f->count++;
+			f->sum += c;
+			if (c > f->max)
+				f->max = c;
+			f->entry = 0;
+		}
+	}
+}
+
+static bool func_add(const char *arg)
+{
+	const char *at = strchr(arg, '@');
+	char *end;
+
+	if (at == NULL || at == arg || funcs == FUNCS)
+		return false;
+	func[funcs].addr = strtoul(at + 1, &end, 16);
+	if (end == at + 1 || *end != 0)
+		return false;
+	func[funcs].name = strndup(arg, at - arg);
+	funcs++;
+	return true;
+}
+
+static avr_cycle_count_t stim_eye(struct avr_t *avr, avr_cycle_count_t when, void *param)
+{
+	static uint8_t level;
+
+	level ^= 1;
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('E'), 1), level);
+	return when + avr_usec_to_cycles(avr, eye_period/2);
+}
+
+static avr_cycle_count_t stim_rfm(struct avr_t *avr, avr_cycle_count_t when, void *param)
+{
+	static uint8_t level;
+
+	// FFIT rises when 8 bits are in the FIFO, the ISR reads it and SDO falls
+	level ^= 1;
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('E'), 6), level);
+	return when + avr_usec_to_cycles(avr, byte_us/2);
+}
+
+static avr_cycle_count_t stim_key(struct avr_t *avr, avr_cycle_count_t when, void *param)
+{
+	static uint8_t n;
+	uint8_t bit = (n >> 1) % 3 + 4;     // menu, timer, ok (low active)
+
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), bit), n & 1);
+	n++;
+	return when + avr_usec_to_cycles(avr, (n & 1) ? 300000 : key_period);
+}
+
+/*!
+ *******************************************************************************
+ *  limit file: "vector max_cycles max_latency", '#' starts a comment
+ ******************************************************************************/
+static bool load_limits(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	char line[128], name[40];
+	long cyc, lat;
+	int i;
+
+	if (f == NULL)
+	{
+		perror(path);
+		return false;
+	}
+	while (fgets(line, sizeof(line), f) != NULL)
+	{
+		if (line[0] == '#' || sscanf(line, "%39s %ld %ld", name, &cyc, &lat) != 3)
+			continue;
+		for (i=0; i<VECTORS; i++)
+		{
+			if (strcmp(name, vector_name[i]) == 0)
+			{
+				stat[i].limit = cyc;
+				stat[i].latency_limit = lat;
+				break;
+			}
+		}
+		if (i == VECTORS)
+			fprintf(stderr, "%s: unknown vector %s\n", path, name);
+	}
+	fclose(f);
+	return true;
+}
+
+static bool isr_pass(const isr_stat_t *s)
+{
+	if (s->limit < 0)
+		return true;
+	return s->count != 0 && s->max <= s->limit && s->latency_max <= s->latency_limit;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *mcu = NULL, *limits = NULL, *report = NULL;
+	uint32_t freq = 4000000, baud = 19200;
+	double seconds = 10;
+	elf_firmware_t fw;
+	avr_cycle_count_t end;
+	FILE *out = stdout;
+	bool pass = true, first = true;
+	uint32_t byte_cycles;
+	int opt, i, state;
+
+	while ((opt = getopt(argc, argv, "m:f:t:b:l:o:F:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'm': mcu = optarg; break;
+			case 'f': freq = strtoul(optarg, NULL, 0); break;
+			case 't': seconds = strtod(optarg, NULL); break;
+			case 'b': baud = strtoul(optarg, NULL, 0); break;
+			case 'l': limits = optarg; break;
+			case 'o': report = optarg; break;
+			case 'F':
+				if (!func_add(optarg))
+				{
+					fprintf(stderr, "bad function %s, expected name@hexaddress\n", optarg);
+					return 2;
+				}
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-m mcu] [-f hz] [-t seconds] [-b baud]"
+					" [-l limitfile] [-o report] [-F name@address] firmware.elf\n", argv[0]);
+				return 2;
+		}
+	}
+	if (optind >= argc)
+		return 2;
+
+	for (i=0; i<VECTORS; i++)
+		stat[i].limit = stat[i].latency_limit = -1;
+	if (limits != NULL && !load_limits(limits))
+		return 2;
+
+	memset(&fw, 0, sizeof(fw));
+	if (elf_read_firmware(argv[optind], &fw) != 0)
+	{
+		fprintf(stderr, "%s: can not read firmware\n", argv[optind]);
+		return 2;
+	}
+	if (mcu == NULL)
+		mcu = fw.mmcu[0] ? fw.mmcu : "atmega169p";
+	avr = avr_make_mcu_by_name(mcu);
+	if (avr == NULL)
+	{
+		fprintf(stderr, "simavr does not know %s\n", mcu);
+		return 2;
+	}
+	avr_init(avr);
+	avr_load_firmware(avr, &fw);
+	avr->frequency = freq;
+
+	for (i=1; i<VECTORS; i++)
+	{
+		avr_irq_t *irq = avr_get_interrupt_irq(avr, i);
+
+		if (irq == NULL)
+			continue;
+		avr_irq_register_notify(irq + AVR_INT_IRQ_PENDING, isr_pending, &stat[i]);
+		avr_irq_register_notify(irq + AVR_INT_IRQ_RUNNING, isr_running, &stat[i]);
+	}
+
+	byte_us = 8000000UL/baud;
+	byte_cycles = (uint32_t)((uint64_t)freq*8/baud);
+	avr_cycle_timer_register_usec(avr, eye_period/2, stim_eye, NULL);
+	avr_cycle_timer_register_usec(avr, byte_us/2, stim_rfm, NULL);
+	avr_cycle_timer_register_usec(avr, key_period, stim_key, NULL);
+
+	end = (avr_cycle_count_t)(seconds*freq);
+	do
+	{
+		state = avr_run(avr);
+		func_step();
+	} while (state != cpu_Done && state != cpu_Crashed && avr->cycle < end);
+
+	if (report != NULL && (out = fopen(report, "w")) == NULL)
+	{
+		perror(report);
+		return 2;
+	}
+	fprintf(out, "{\n  \"firmware\": \"%s\",\n  \"mcu\": \"%s\",\n  \"frequency\": %u,\n",
+		argv[optind], mcu, freq);
+	fprintf(out, "  \"cycles\": %llu,\n  \"crashed\": %s,\n",
+		(unsigned long long)avr->cycle, state == cpu_Crashed ? "true" : "false");
+	fprintf(out, "  \"radio_byte_cycles\": %u,\n  \"isr\": {", byte_cycles);
+	for (i=1; i<VECTORS; i++)
+	{
+		isr_stat_t *s = &stat[i];
+		bool ok = isr_pass(s);
+
+		if (s->count == 0 && s->limit < 0)
+			continue;
+		fprintf(out, "%s\n    \"%s\": { \"count\": %llu, \"avg\": %.1f, \"max\": %u, \"latency_max\": %u",
+			first ? "" : ",", vector_name[i], (unsigned long long)s->count,
+			s->count ? (double)s->sum/s->count : 0.0, s->max, s->latency_max);
+		if (s->limit >= 0)
+			fprintf(out, ", \"limit\": %ld, \"latency_limit\": %ld, \"pass\": %s",
+				s->limit, s->latency_limit, ok ? "true" : "false");
+		fprintf(out, " }");
+		first = false;
+		pass = pass && ok;
+	}
+	// a received byte is lost if the RFM interrupt can not be served in time
+	pass = pass && (stat[VECTOR_PCINT0].latency_max + stat[VECTOR_PCINT0].max < byte_cycles) && state != cpu_Crashed;
+	fprintf(out, "\n  },\n  \"functions\": {");
+	for (i=0; i<funcs; i++)
+		fprintf(out, "%s\n    \"%s\": { \"count\": %llu, \"avg\": %.1f, \"max\": %u }",
+			i ? "," : "", func[i].name, (unsigned long long)func[i].count,
+			func[i].count ? (double)func[i].sum/func[i].count : 0.0, func[i].max);
+	fprintf(out, "\n  },\n  \"radio_margin_cycles\": %ld,\n  \"pass\": %s\n}\n",
+		(long)byte_cycles - stat[VECTOR_PCINT0].latency_max - stat[VECTOR_PCINT0].max, pass ? "true" : "false");
+	if (out != stdout)
+		fclose(out);
+	avr_terminate(avr);
+	return pass ? 0 : 1;
+}
@@ -0,0 +1,790 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), radio master daemon
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/master.c
+ * \brief      reference radio master for many HR20 slaves
+ *
+ * The master side of the protocol wireless.c expects: a time sync packet
+ * at every :00 and :30, answers to the slave packets sent in their time
+ * slots and the 'V','D','T','G','S','R','W','B','M','A','L','U','H' commands of
+ * COM_wireless_command_parse().
+ *
+ * The radio is a stand-in reached over a UNIX seqpacket socket, one
+ * message per frame: the channel number followed by the frame as it goes
+ * on air, wl_header, length, address, data and 4 MAC bytes. The MAC is
+ * sent as zeros because cmac_calc() of the slaves accepts every packet.
+ *
+ * Commands come in on a UNIX stream control socket as text lines
+ *   <channel> <address> <command> [arguments]     e.g. "0 5 A 42"
+ *   stats
+ * and are answered with "<id> queued", later "<id> ok ..." with the reply
+ * bytes and the latency in ms, or "<id> timeout". Debug packets of the
+ * slaves are passed to every control client as "D <channel> <address> ...".
+ *
+ * A slave only listens in its own slot when it has something to send, so
+ * the master forces slots for the addresses with waiting commands in the
+ * sync packet: 0x8b for up to two addresses in the second half of the
+ * minute, 0x8d with the address bitmap otherwise. A plain sync lets the
+ * slaves sleep through the next WL_SKIP_SYNC syncs, it is only sent with
+ * no command waiting and a latency bound long enough to cover the sleep.
+ * Every command not answered within the bound is dropped with "timeout".
+ * Unanswered commands are sent again, delivery is at least once.
+ *
+ * Everything runs in one epoll loop: the radio, a 1 s timerfd aligned to
+ * the wall clock second and the control connections.
+ *
+ * usage: Zero_master [-r radio.sock] [-c control.sock] [-n channels]
+ *                    [-l seconds] [-b] [-v]
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+/* protocol constants of the firmware, see rfm.h, wireless.h and eeprom.h */
+#define FRAME_MAX       80      //!< RFM_FRAME_MAX
+#define MAC_SIZE        4
+#define ADDRESSES       30      //!< RFM_devaddr 1..29, 0 = master
+#define SKIP_SYNC       3       //!< WL_SKIP_SYNC
+#define SYNC_PLAIN      0x89
+#define SYNC_FORCE      0x8b
+#define SYNC_FLAGS      0x8d
+#define DEBUG_SIZE      9       //!< COM_print_debug() without 'D'
+#define DEBUG_SIZE_BAT  11      //!< the same with BAT_FORECAST
+#define TEMP_LOW        (5*2-1) //!< TEMP_MIN-1, lowest value 'A' takes
+#define TEMP_HIGH       (30*2+1)
+
+/* reply data of one frame, COM_wireless_command_parse() writes the reply
+ * into the same buffer the commands are read from */
+#define BATCH_MAX       (FRAME_MAX-6-6)
+#define VERSION_SIZE    64      //!< budget for the 'V' reply
+#define REPLY_TEXT      0xff
+#define REPLY_DEBUG     0xfe    //!< debug_size
+
+#define QUEUE_MAX       32      //!< waiting commands per slave
+#define CLIENTS         32
+#define LINE_MAX        256
+
+static const uint8_t wl_header[4] = {0xaa, 0xaa, 0x2d, 0xd4};
+
+typedef struct {
+	char code;
+	uint8_t args;
+	uint8_t reply;          //!< bytes after the echo, REPLY_TEXT = up to '\n'
+} cmd_def_t;
+
+static const cmd_def_t cmd_def[] = {
+	{'V', 0, REPLY_TEXT},
+	{'D', 0, REPLY_DEBUG},
+	{'T', 1, 3},
+	{'G', 1, 2},
+	{'S', 2, 2},
+	{'R', 1, 3},
+	{'W', 3, 3},
+	{'B', 2, 2},
+	{'M', 1, REPLY_DEBUG},
+	{'A', 1, REPLY_DEBUG},
+	{'L', 1, 1},
+	{'U', 1, 1},
+	{'H', 1, 9},
+};
+
+typedef struct cmd_s {
+	struct cmd_s *next;
+	const cmd_def_t *def;
+	uint8_t arg[3];
+	uint32_t id;
+	uint8_t client;          //!< control connection
+	uint32_t gen;            //!< its generation, a closed one is ignored
+	double queued;
+	double deadline;
+} cmd_t;
+
+typedef struct {
+	cmd_t *queue;            //!< the first "sent" entries are in flight
+	uint8_t queued;
+	uint8_t sent;
+	double sent_at;
+	uint64_t uplinks;
+} node_t;
+
+typedef struct {
+	node_t node[ADDRESSES];
+	uint8_t skip;            //!< syncs the slaves sleep through
+	uint64_t sync[3];        //!< plain, force, flags
+	uint64_t rx, tx, bad, done, timeout, retry;
+	double latency_sum;
+	double latency_max;
+} channel_t;
+
+typedef struct {
+	int fd;                  //!< -1 = free
+	uint32_t gen;
+	size_t len;
+	char line[LINE_MAX];
+} client_t;
+
+enum { EV_RADIO, EV_TIMER, EV_LISTEN, EV_CLIENT };
+
+static channel_t *channel;
+static unsigned channels = 1;
+static double latency_bound = 60;
+static bool verbose;
+static unsigned debug_size = DEBUG_SIZE;  //!< reply of 'D', 'M' and 'A'
+static int radio_fd = -1;
+static int epoll_fd = -1;
+static client_t client[CLIENTS];
+static uint32_t client_gen;
+static uint32_t cmd_id;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void client_close(unsigned i)
+{
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client[i].fd, NULL);
+	close(client[i].fd);
+	client[i].fd = -1;
+}
+
+/*!
+ *******************************************************************************
+ *  write one line to a control client, a client that does not read its
+ *  replies is dropped rather than blocking the radio
+ ******************************************************************************/
+static void client_printf(unsigned i, uint32_t gen, const char *fmt, ...)
+{
+	char buf[LINE_MAX*2];
+	va_list ap;
+	int n;
+
+	if (i >= CLIENTS || client[i].fd < 0 || client[i].gen != gen)
+		return;
+	va_start(ap, fmt);
+	n = vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	if (n >= (int)sizeof(buf))
+		n = sizeof(buf) - 1;
+	if (send(client[i].fd, buf, n, MSG_NOSIGNAL | MSG_DONTWAIT) != n)
+		client_close(i);
+}
+
+static void hex(char *s, const uint8_t *p, unsigned n)
+{
+	*s = 0;
+	while (n--)
+		s += sprintf(s, "%02x", *p++);
+}
+
+static void debug_text(char *s, const uint8_t *p)
+{
+	s += sprintf(s, "temp=%.2f bat=%u wanted=%.1f valve=%u err=0x%02x%s%s",
+		((p[3] << 8) | p[4]) / 100.0, (p[5] << 8) | p[6],
+		p[7] / 2.0, p[8], p[2],
+		(p[0] & 0x80) ? " auto" : "", (p[1] & 0x80) ? " locked" : "");
+	if (debug_size == DEBUG_SIZE_BAT && ((p[9] << 8) | p[10]) != 0xffff)
+		sprintf(s, " days=%u", (p[9] << 8) | p[10]);
+}
+
+//! reply bytes of a command, the budget of a text reply
+static unsigned reply_size(const cmd_def_t *d)
+{
+	if (d->reply == REPLY_TEXT)
+		return VERSION_SIZE;
+	if (d->reply == REPLY_DEBUG)
+		return debug_size;
+	return d->reply;
+}
+
+static void radio_send(unsigned ch, uint8_t *f)
+{
+	uint8_t buf[1+sizeof(wl_header)+FRAME_MAX];
+	uint8_t len = f[0] & 0x7f;
+
+	// slaves do not check the MAC, see cmac_calc()
+	memset(f + len - MAC_SIZE, 0, MAC_SIZE);
+	buf[0] = ch;
+	memcpy(buf + 1, wl_header, sizeof(wl_header));
+	memcpy(buf + 1 + sizeof(wl_header), f, len);
+	if (send(radio_fd, buf, 1 + sizeof(wl_header) + len, MSG_NOSIGNAL) < 0)
+		perror("radio");
+	channel[ch].tx++;
+	if (verbose)
+	{
+		char s[2*FRAME_MAX+1];
+
+		hex(s, f, len);
+		fprintf(stderr, "tx %u %s\n", ch, s);
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  send the sync packet of one channel at :00 or :30
+ ******************************************************************************/
+static void sync_send(unsigned ch, const struct tm *tm)
+{
+	channel_t *c = &channel[ch];
+	uint8_t f[1+4+4+MAC_SIZE];
+	uint32_t flags = 0;
+	uint8_t force[2] = {0, 0};
+	unsigned a, n = 0;
+
+	for (a = 1; a < ADDRESSES; a++)
+	{
+		if (c->node[a].queued)
+		{
+			flags |= 1UL << a;
+			if (n < 2)
+				force[n] = a;
+			n++;
+		}
+	}
+
+	f[1] = tm->tm_year - 100;
+	f[2] = ((tm->tm_mon + 1) << 4) | ((tm->tm_mday >> 3) & 3);
+	f[3] = ((tm->tm_mday & 7) << 5) | tm->tm_hour;
+	f[4] = (tm->tm_min << 1) | (tm->tm_sec >= 30);
+
+	if (n != 0 && n <= 2 && tm->tm_sec >= 30)
+	{
+		// every odd/even second after 30 for one address each
+		f[0] = SYNC_FORCE;
+		f[5] = force[0];
+		f[6] = force[1];
+		c->sync[1]++;
+	}
+	else if (n == 0 && c->skip == 0 && latency_bound >= (SKIP_SYNC + 2) * 30)
+	{
+		f[0] = SYNC_PLAIN;
+		c->sync[0]++;
+	}
+	else
+	{
+		// also without flags, this keeps the slaves listening to the syncs
+		f[0] = SYNC_FLAGS;
+		f[5] = flags;
+		f[6] = flags >> 8;
+		f[7] = flags >> 16;
+		f[8] = flags >> 24;
+		c->sync[2]++;
+	}
+
+	if (f[0] == SYNC_PLAIN)
+		c->skip = SKIP_SYNC;
+	else if (c->skip > 0)
+		c->skip--;
+	radio_send(ch, f);
+}
+
+/*!
+ *******************************************************************************
+ *  answer a slave packet with the next batch of commands, an empty packet
+ *  if there is none lets the slave switch its receiver off
+ ******************************************************************************/
+static void node_reply(unsigned ch, unsigned addr)
+{
+	node_t *n = &channel[ch].node[addr];
+	uint8_t f[FRAME_MAX];
+	uint8_t len = 2;
+	unsigned budget = 0;
+	cmd_t *c;
+
+	f[1] = 0;
+	n->sent = 0;
+	for (c = n->queue; c != NULL; c = c->next)
+	{
+		unsigned size = 1 + c->def->args + 1 + reply_size(c->def);
+
+		if (n->sent != 0 && budget + size > BATCH_MAX)
+			break;
+		budget += size;
+		f[len++] = c->def->code;
+		memcpy(f + len, c->arg, c->def->args);
+		len += c->def->args;
+		n->sent++;
+	}
+	f[0] = len + MAC_SIZE;
+	n->sent_at = now();
+	radio_send(ch, f);
+}
+
+static void cmd_done(unsigned ch, unsigned addr, cmd_t *c, const uint8_t *p, unsigned size)
+{
+	channel_t *chan = &channel[ch];
+	double latency = now() - c->queued;
+	char s[2*FRAME_MAX+64];
+
+	chan->done++;
+	chan->latency_sum += latency;
+	if (latency > chan->latency_max)
+		chan->latency_max = latency;
+
+	if (c->def->reply == REPLY_TEXT)
+	{
+		s[0] = '"';
+		memcpy(s + 1, p, size);
+		s[size + 1 - (size && p[size-1] == '\n')] = 0;
+		strcat(s, "\"");
+	}
+	else if (c->def->reply == REPLY_DEBUG)
+		debug_text(s, p);
+	else
+		hex(s, p, size);
+	client_printf(c->client, c->gen, "%u ok %u %u %c %s %.0f\n",
+		c->id, ch, addr, c->def->code, s, latency * 1000);
+	free(c);
+}
+
+/*!
+ *******************************************************************************
+ *  match the reply items of an uplink with the commands in flight, the
+ *  ones without a reply are sent again with the next frame
+ ******************************************************************************/
+static void node_parse(unsigned ch, unsigned addr, const uint8_t *p, unsigned size)
+{
+	node_t *n = &channel[ch].node[addr];
+	unsigned pos = 0;
+	char s[LINE_MAX];
+	unsigned i;
+
+	while (pos < size)
+	{
+		cmd_t *c = n->queue;
+		unsigned r;
+
+		if (p[pos] == 'D')
+		{
+			if (pos + 1 + debug_size > size)
+				break;
+			debug_text(s, p + pos + 1);
+			for (i = 0; i < CLIENTS; i++)
+				client_printf(i, client[i].gen, "D %u %u %s\n", ch, addr, s);
+			pos += 1 + debug_size;
+			continue;
+		}
+		if (n->sent == 0 || c == NULL || p[pos] != (c->def->code | 0x80))
+			break;
+		if (c->def->reply == REPLY_TEXT)
+		{
+			for (r = 0; pos + 1 + r < size && p[pos + 1 + r] != '\n'; r++)
+				;
+			if (pos + 1 + r < size)
+				r++;
+		}
+		else
+			r = reply_size(c->def);
+		if (pos + 1 + r > size)
+			break;
+		n->queue = c->next;
+		n->queued--;
+		n->sent--;
+		cmd_done(ch, addr, c, p + pos + 1, r);
+		pos += 1 + r;
+	}
+	if (n->sent != 0)
+	{
+		channel[ch].retry += n->sent;
+		n->sent = 0;
+	}
+}
+
+static void radio_receive(void)
+{
+	uint8_t buf[1+sizeof(wl_header)+FRAME_MAX+2];
+	const uint8_t *f = buf + 1 + sizeof(wl_header);
+	ssize_t size = recv(radio_fd, buf, sizeof(buf), 0);
+	unsigned ch, len, addr;
+
+	if (size <= 0)
+	{
+		fprintf(stderr, "radio closed\n");
+		exit(1);
+	}
+	ch = buf[0];
+	if (ch >= channels)
+		return;
+	len = f[0] & 0x7f;
+	if (size < 2 + (ssize_t)sizeof(wl_header) ||
+		memcmp(buf + 1, wl_header, sizeof(wl_header)) != 0 ||
+		len < 2 + MAC_SIZE || len >= FRAME_MAX ||
+		size < 1 + (ssize_t)sizeof(wl_header) + len)
+	{
+		channel[ch].bad++;
+		return;
+	}
+	addr = f[1];
+	if ((f[0] & 0x80) || addr == 0)
+		return;     // another master
+	if (addr >= ADDRESSES)
+	{
+		channel[ch].bad++;
+		return;
+	}
+	if (verbose)
+	{
+		char s[2*FRAME_MAX+1];
+
+		hex(s, f, len);
+		fprintf(stderr, "rx %u %s\n", ch, s);
+	}
+	channel[ch].rx++;
+	channel[ch].node[addr].uplinks++;
+	node_parse(ch, addr, f + 2, len - 2 - MAC_SIZE);
+	node_reply(ch, addr);
+}
+
+/*!
+ *******************************************************************************
+ *  drop commands past their deadline, a batch still unanswered one second
+ *  after it was sent will not be answered anymore
+ ******************************************************************************/
+static void expire(void)
+{
+	double t = now();
+	unsigned ch, a;
+
+	for (ch = 0; ch < channels; ch++)
+	{
+		for (a = 1; a < ADDRESSES; a++)
+		{
+			node_t *n = &channel[ch].node[a];
+			cmd_t **pc = &n->queue;
+			unsigned k;
+
+			if (n->sent != 0 && t - n->sent_at > 1)
+				n->sent = 0;
+			for (k = 0; *pc != NULL; k++)
+			{
+				cmd_t *c = *pc;
+
+				if (k >= n->sent && t > c->deadline)
+				{
+					*pc = c->next;
+					n->queued--;
+					channel[ch].timeout++;
+					client_printf(c->client, c->gen, "%u timeout\n", c->id);
+					free(c);
+				}
+				else
+					pc = &c->next;
+			}
+		}
+	}
+}
+
+static void timer_tick(int fd)
+{
+	uint64_t ticks;
+	time_t t = time(NULL);
+	struct tm tm;
+	unsigned ch;
+
+	if (read(fd, &ticks, sizeof(ticks)) != sizeof(ticks))
+		return;
+	localtime_r(&t, &tm);
+	if (tm.tm_sec == 0 || tm.tm_sec == 30)
+	{
+		for (ch = 0; ch < channels; ch++)
+			sync_send(ch, &tm);
+	}
+	expire();
+}
+
+static void stats(unsigned i)
+{
+	unsigned ch;
+
+	for (ch = 0; ch < channels; ch++)
+	{
+		channel_t *c = &channel[ch];
+
+		client_printf(i, client[i].gen,
+			"stats %u rx=%llu tx=%llu bad=%llu sync=%llu/%llu/%llu done=%llu"
+			" retry=%llu timeout=%llu latency=%.0f/%.0f\n", ch,
+			(unsigned long long)c->rx, (unsigned long long)c->tx,
+			(unsigned long long)c->bad, (unsigned long long)c->sync[0],
+			(unsigned long long)c->sync[1], (unsigned long long)c->sync[2],
+			(unsigned long long)c->done, (unsigned long long)c->retry,
+			(unsigned long long)c->timeout,
+			c->done ? c->latency_sum * 1000 / c->done : 0,
+			c->latency_max * 1000);
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  one line of the control protocol
+ ******************************************************************************/
+static void control_line(unsigned i, char *line)
+{
+	unsigned long ch, addr, v;
+	char code, *s;
+	const cmd_def_t *d = NULL;
+	cmd_t *c, **pc;
+	unsigned k;
+	uint32_t gen = client[i].gen;
+
+	if (strncmp(line, "stats", 5) == 0)
+	{
+		stats(i);
+		return;
+	}
+	if (sscanf(line, "%lu %lu %c", &ch, &addr, &code) != 3)
+	{
+		client_printf(i, gen, "error syntax\n");
+		return;
+	}
+	for (k = 0; k < sizeof(cmd_def)/sizeof(cmd_def[0]); k++)
+		if (cmd_def[k].code == code)
+			d = &cmd_def[k];
+	if (ch >= channels || addr == 0 || addr >= ADDRESSES || d == NULL)
+	{
+		client_printf(i, gen, "error address or command\n");
+		return;
+	}
+	if (channel[ch].node[addr].queued >= QUEUE_MAX)
+	{
+		client_printf(i, gen, "error queue full\n");
+		return;
+	}
+
+	c = calloc(1, sizeof(*c));
+	c->def = d;
+	s = strchr(line, code) + 1;
+	for (k = 0; k < d->args; k++)
+	{
+		char *e;
+
+		v = strtoul(s, &e, 0);
+		if (e == s || v > 0xff)
+		{
+			client_printf(i, gen, "error argument\n");
+			free(c);
+			return;
+		}
+		c->arg[k] = v;
+		s = e;
+	}
+	// an 'A' out of range is not consumed by the slave, its argument
+	// would be parsed as the next command
+	if (code == 'A' && (c->arg[0] < TEMP_LOW || c->arg[0] > TEMP_HIGH))
+	{
+		client_printf(i, gen, "error argument\n");
+		free(c);
+		return;
+	}
+	c->id = ++cmd_id;
+	c->client = i;
+	c->gen = gen;
+	c->queued = now();
+	c->deadline = c->queued + latency_bound;
+	for (pc = &channel[ch].node[addr].queue; *pc != NULL; pc = &(*pc)->next)
+		;
+	*pc = c;
+	channel[ch].node[addr].queued++;
+	client_printf(i, gen, "%u queued\n", c->id);
+}
+
+static void control_read(unsigned i)
+{
+	client_t *cl = &client[i];
+	ssize_t n = recv(cl->fd, cl->line + cl->len, sizeof(cl->line) - 1 - cl->len, 0);
+	char *eol;
+
+	if (n <= 0)
+	{
+		client_close(i);
+		return;
+	}
+	cl->len += n;
+	cl->line[cl->len] = 0;
+	while (cl->fd >= 0 && (eol = strchr(cl->line, '\n')) != NULL)
+	{
+		*eol = 0;
+		control_line(i, cl->line);
+		cl->len -= eol + 1 - cl->line;
+		memmove(cl->line, eol + 1, cl->len + 1);
+	}
+	if (cl->fd >= 0 && cl->len == sizeof(cl->line) - 1)
+		client_close(i);    // line too long
+}
+
+static void control_accept(int listen_fd)
+{
+	struct epoll_event ev;
+	int fd = accept(listen_fd, NULL, NULL);
+	unsigned i;
+
+	if (fd < 0)
+		return;
+	for (i = 0; i < CLIENTS && client[i].fd >= 0; i++)
+		;
+	if (i == CLIENTS)
+	{
+		close(fd);
+		return;
+	}
+	client[i].fd = fd;
+	client[i].gen = ++client_gen;
+	client[i].len = 0;
+	ev.events = EPOLLIN;
+	ev.data.u32 = EV_CLIENT + i;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static int unix_socket(const char *path, int type, bool server)
+{
+	struct sockaddr_un sa;
+	int fd = socket(AF_UNIX, type | SOCK_CLOEXEC, 0);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	strncpy(sa.sun_path, path, sizeof(sa.sun_path) - 1);
+	if (server)
+	{
+		unlink(path);
+		if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(fd, 8) < 0)
+			fd = -1;
+	}
+	else if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+		fd = -1;
+	if (fd < 0)
+		perror(path);
+	return fd;
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: master [-r radio.sock] [-c control.sock] [-n channels]\n"
+		"              [-l seconds] [-b] [-v]\n"
+		"  -r  radio stand-in, seqpacket: channel byte + frame\n"
+		"  -c  control socket\n"
+		"  -n  radio channels (1)\n"
+		"  -l  latency bound of a command (60 s), >= %u allows plain syncs\n"
+		"  -b  slaves built with BAT_FORECAST, 'D' carries the days left\n"
+		"  -v  print every frame\n", (SKIP_SYNC + 2) * 30);
+	exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *radio_path = "hr20radio.sock";
+	const char *control_path = "hr20master.sock";
+	struct itimerspec its;
+	struct epoll_event ev;
+	int listen_fd, timer_fd;
+	unsigned i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "r:c:n:l:bv")) != -1)
+	{
+		switch (opt)
+		{
+		case 'r': radio_path = optarg; break;
+		case 'c': control_path = optarg; break;
+		case 'n': channels = strtoul(optarg, NULL, 0); break;
+		case 'l': latency_bound = strtod(optarg, NULL); break;
+		case 'b': debug_size = DEBUG_SIZE_BAT; break;
+		case 'v': verbose = true; break;
+		default: usage();
+		}
+	}
+	if (channels == 0 || channels > 256 || latency_bound <= 0)
+		usage();
+
+	channel = calloc(channels, sizeof(*channel));
+	for (i = 0; i < CLIENTS; i++)
+		client[i].fd = -1;
+
+	radio_fd = unix_socket(radio_path, SOCK_SEQPACKET, false);
+	listen_fd = unix_socket(control_path, SOCK_STREAM, true);
+	if (radio_fd < 0 || listen_fd < 0)
+		return 1;
+
+	// 1 s ticks on the wall clock second, syncs go out at :00 and :30
+	timer_fd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC);
+	clock_gettime(CLOCK_REALTIME, &its.it_value);
+	its.it_value.tv_sec++;
+	its.it_value.tv_nsec = 0;
+	its.it_interval.tv_sec = 1;
+	its.it_interval.tv_nsec = 0;
+	timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	ev.events = EPOLLIN;
+	ev.data.u32 = EV_RADIO;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, radio_fd, &ev);
+	ev.data.u32 = EV_TIMER;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev);
+	ev.data.u32 = EV_LISTEN;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+
+	for (;;)
+	{
+		struct epoll_event events[16];
+		int n = epoll_wait(epoll_fd, events, 16, -1);
+
+		if (n < 0 && errno != EINTR)
+		{
+			perror("epoll");
+			return 1;
+		}
+		// radio first, the slave waits only WLTIME_TIMEOUT for the answer
+		for (i = 0; i < (unsigned)n; i++)
+			if (events[i].data.u32 == EV_RADIO)
+				radio_receive();
+		for (i = 0; i < (unsigned)n; i++)
+		{
+			switch (events[i].data.u32)
+			{
+			case EV_RADIO:
+				break;
+			case EV_TIMER:
+				timer_tick(timer_fd);
+				break;
+			case EV_LISTEN:
+				control_accept(listen_fd);
+				break;
+			default:
+				if (client[events[i].data.u32 - EV_CLIENT].fd >= 0)
+					control_read(events[i].data.u32 - EV_CLIENT);
+				break;
+			}
+		}
+	}
+}
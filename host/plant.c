@@ -0,0 +1,98 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/plant.c
+ * \brief      room and radiator thermal model for controller benchmarks
+ */
+
+#include <stdint.h>
+
+#include "plant.h"
+
+#define PLANT_DRAUGHT_TAU 30.0  //!< draught at the sensor [s]
+
+/*
+ * 20 m2 room with 500 W loss at 20 K difference, 2 kW radiator (at 50 K
+ * excess), 55 C supply. Holding 20 C needs about 40 % valve, full flow
+ * gives 280 W reserve, which heats the room by roughly 0.7 K per hour.
+ */
+const plant_param_t plant_default = {
+	.c_room = 1.5e6,
+	.c_rad = 8.0e4,
+	.ua_loss = 25.0,
+	.ua_window = 150.0,
+	.ua_rad = 40.0,
+	.flow_max = 50.0,
+	.t_supply = 55.0,
+	.t_out = 0.0,
+	.sensor_coupling = 0.05,
+	.valve_closed = 20,
+	.valve_open = 90,
+	.quick_open = 1.0,
+	.draught = 0.0,
+};
+
+//! relative flow for valve position [%]
+static double plant_flow(const plant_param_t *p, uint8_t valve)
+{
+	double x;
+
+	if (valve <= p->valve_closed)
+		return 0;
+	if (valve >= p->valve_open)
+		return 1;
+	x = (double)(valve - p->valve_closed)/(p->valve_open - p->valve_closed);
+	return x*(1 + p->quick_open)/(1 + p->quick_open*x);
+}
+
+/*!
+ *******************************************************************************
+ *  radiator temperature that keeps the room at \a t_room without solar gain
+ ******************************************************************************/
+void plant_steady(const plant_param_t *p, plant_state_t *s, double t_room)
+{
+	s->t_room = t_room;
+	s->t_rad = t_room + p->ua_loss*(t_room - p->t_out)/p->ua_rad;
+	s->solar = 0;
+	s->window = 0;
+	s->t_draught = 0;
+}
+
+/*!
+ *******************************************************************************
+ *  advance the model by \a dt seconds (explicit Euler, dt << c_rad/flow_max)
+ ******************************************************************************/
+void plant_step(const plant_param_t *p, plant_state_t *s, uint8_t valve, double dt)
+{
+	double q_water = plant_flow(p, valve)*p->flow_max*(p->t_supply - s->t_rad);
+	double q_rad = p->ua_rad*(s->t_rad - s->t_room);
+	double ua = p->ua_loss + (s->window ? p->ua_window : 0);
+	double q_loss = ua*(s->t_room - p->t_out);
+
+	s->t_rad += (q_water - q_rad)*dt/p->c_rad;
+	s->t_room += (q_rad - q_loss + s->solar)*dt/p->c_room;
+	s->t_draught += ((s->window ? p->draught : 0) - s->t_draught)*dt/PLANT_DRAUGHT_TAU;
+}
+
+//! temperature at the thermostat sensor [C]
+double plant_sensor(const plant_param_t *p, const plant_state_t *s)
+{
+	return s->t_room + p->sensor_coupling*(s->t_rad - s->t_room) - s->t_draught;
+}
@@ -0,0 +1,64 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/plant.h
+ * \brief      room and radiator thermal model for controller benchmarks
+ *
+ * Two lumped heat capacities: the radiator is fed by hot water through the
+ * valve, the room loses heat to outside (more with an open window) and can
+ * get solar gain. The thermostat sensor sits at the radiator and reads a
+ * fraction of the radiator excess temperature. Cold air from an open
+ * window reaches the sensor long before the room has cooled down, modelled
+ * as a draught that lowers the sensor reading with a 30 s time constant.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+	double c_room;         //!< room heat capacity [J/K]
+	double c_rad;          //!< radiator with water [J/K]
+	double ua_loss;        //!< room to outside [W/K]
+	double ua_window;      //!< additional loss with open window [W/K]
+	double ua_rad;         //!< radiator to room [W/K]
+	double flow_max;       //!< water flow heat capacity, valve fully open [W/K]
+	double t_supply;       //!< supply water [C]
+	double t_out;          //!< outside [C]
+	double sensor_coupling; //!< part of radiator excess seen by the sensor
+	uint8_t valve_closed;  //!< valve position [%] where flow starts
+	uint8_t valve_open;    //!< valve position [%] of full flow
+	double quick_open;     //!< >0 makes most flow at small openings
+	double draught;        //!< sensor drop by the cold air of an open window [K]
+} plant_param_t;
+
+typedef struct {
+	double t_room;         //!< [C]
+	double t_rad;          //!< [C]
+	double solar;          //!< solar gain [W]
+	uint8_t window;        //!< window open
+	double t_draught;      //!< current sensor drop by the draught [K]
+} plant_state_t;
+
+extern const plant_param_t plant_default;
+
+void plant_steady(const plant_param_t *p, plant_state_t *s, double t_room);
+void plant_step(const plant_param_t *p, plant_state_t *s, uint8_t valve, double dt);
+double plant_sensor(const plant_param_t *p, const plant_state_t *s);
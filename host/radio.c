@@ -0,0 +1,348 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/radio.c
+ * \brief      the other end of the radio link in the event simulation
+ *
+ * Two peers for the RFM12 model (rfm12.c):
+ *  - a built-in master (-R) that sends a time sync every 30 s of
+ *    simulated time and answers every packet of the slave, with the next
+ *    of the commands queued by -Q or with an empty packet. Syncs are plain
+ *    while no command waits, 0x8d with the flag of the slave otherwise.
+ *    One command goes out per packet, the answers are printed.
+ *  - a bridge (-W) to a master on a UNIX seqpacket socket, e.g.
+ *    host/master.c: the simulation waits for the master to connect and
+ *    then runs in real time. Frames are exchanged as the channel byte
+ *    followed by the frame from wl_header on.
+ *
+ * MAC bytes are zero, cmac_calc() of this tree accepts every packet. A 'B'
+ * reboot command ends in the loop waiting for the watchdog, which the host
+ * build does not have, -Q refuses it.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "config.h"
+#include "eeprom.h"
+
+#include "des.h"
+#include "rfm12.h"
+#include "radio.h"
+
+#define SYNC_PERIOD     (30*DES_SECOND)
+#define TURNAROUND      (3*DES_SECOND/1000)    //!< master answer delay
+#define MAC_SIZE        4
+#define COMMANDS        16
+
+bool radio_master;
+
+static const uint8_t wl_header[4] = {0xaa, 0xaa, 0x2d, 0xd4};
+
+typedef struct {
+	char code;
+	uint8_t args;
+	uint8_t arg[3];
+} radio_cmd_t;
+
+//! argument bytes of the commands of COM_wireless_command_parse()
+static const char cmd_codes[] = "VDTGSRWBMALUH";
+static const uint8_t cmd_args[] = {0, 0, 1, 1, 2, 1, 3, 2, 1, 1, 1, 1, 1};
+
+static radio_cmd_t cmd[COMMANDS];
+static unsigned cmd_n, cmd_pos;
+static bool cmd_sent;
+
+static struct {
+	uint64_t sync_plain;
+	uint64_t sync_flags;
+	uint64_t uplinks;
+	uint64_t answers;
+	uint64_t retries;
+} stats;
+
+static des_time_t sync_next;
+static time_t epoch;               //!< master clock at simulation start
+
+static int bridge_fd = -1;
+static double bridge_wall0;
+
+static double wall_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+/*!
+ *******************************************************************************
+ *  -Q option: queue a command for the slave, e.g. "A 42" or "G 0x2c"
+ ******************************************************************************/
+bool radio_command(const char *arg)
+{
+	const char *c = strchr(cmd_codes, arg[0]);
+	radio_cmd_t *q = &cmd[cmd_n];
+	char *end;
+	uint8_t i;
+
+	if (arg[0] == 0 || c == NULL || arg[0] == 'B' || cmd_n == COMMANDS)
+		return false;
+	q->code = arg[0];
+	q->args = cmd_args[c - cmd_codes];
+	arg++;
+	for (i=0; i<q->args; i++)
+	{
+		unsigned long v = strtoul(arg, &end, 0);
+		if (end == arg || v > 0xff)
+			return false;
+		q->arg[i] = (uint8_t)v;
+		arg = end;
+	}
+	cmd_n++;
+	return true;
+}
+
+/*!
+ *******************************************************************************
+ *  put a master frame (length byte to MAC) on the air
+ ******************************************************************************/
+static void master_send(des_time_t start, const uint8_t *f)
+{
+	uint8_t raw[sizeof(wl_header)+0x7f];
+	uint8_t len = f[0] & 0x7f;
+
+	memcpy(raw, wl_header, sizeof(wl_header));
+	memcpy(raw + sizeof(wl_header), f, len - MAC_SIZE);
+	memset(raw + sizeof(wl_header) + len - MAC_SIZE, 0, MAC_SIZE);
+	rfm12_air(start, raw, sizeof(wl_header) + len);
+}
+
+static void master_sync(des_time_t t)
+{
+	time_t now = epoch + (time_t)(t/DES_SECOND);
+	uint32_t flags = 1UL << config.RFM_devaddr;
+	struct tm tm;
+	uint8_t f[13];
+
+	gmtime_r(&now, &tm);
+	f[1] = tm.tm_year - 100;
+	f[2] = ((tm.tm_mon + 1) << 4) | ((tm.tm_mday >> 3) & 3);
+	f[3] = ((tm.tm_mday & 7) << 5) | tm.tm_hour;
+	f[4] = (tm.tm_min << 1) | (tm.tm_sec >= 30);
+	if (cmd_pos < cmd_n)
+	{
+		// force the slot of the slave, it has no data of its own
+		f[0] = 0x8d;
+		memcpy(f + 5, &flags, 4);
+		stats.sync_flags++;
+	}
+	else
+	{
+		f[0] = 0x89;
+		stats.sync_plain++;
+	}
+	master_send(t, f);
+}
+
+//! keep exactly one sync of the master on the air
+static void master_air(const rfm12_frame_t *f)
+{
+	unsigned k;
+
+	if (f == NULL)
+		sync_next = SYNC_PERIOD;
+	else if (f->device || (k = rfm12_sync(f)) == 0 || !(f->data[k] & 0x80))
+		return;
+	else
+		sync_next += SYNC_PERIOD;
+	master_sync(sync_next);
+}
+
+static void master_tx(const rfm12_frame_t *f)
+{
+	unsigned k = rfm12_sync(f);
+	const uint8_t *p = f->data + k;
+	uint8_t r[2+1+3+MAC_SIZE];
+	unsigned n, i;
+
+	if (k == 0 || (p[0] & 0x80) || p[0] < 2 + MAC_SIZE || k + p[0] > f->len)
+		return;
+	stats.uplinks++;
+	n = p[0] - 2 - MAC_SIZE;
+	p += 2;
+
+	if (cmd_sent)
+	{
+		radio_cmd_t *q = &cmd[cmd_pos];
+
+		if (n > 0 && p[0] == (q->code | 0x80))
+		{
+			printf("radio %12.3f s  %c", (double)f->end/DES_SECOND, q->code);
+			for (i=0; i<q->args; i++)
+				printf(" %02x", q->arg[i]);
+			printf("  ->");
+			for (i=1; i<n; i++)
+				printf(" %02x", p[i]);
+			printf("\n");
+			cmd_pos++;
+			stats.answers++;
+		}
+		else
+			stats.retries++;
+		cmd_sent = false;
+	}
+
+	r[1] = 0;
+	n = 2;
+	if (cmd_pos < cmd_n)
+	{
+		radio_cmd_t *q = &cmd[cmd_pos];
+
+		r[n++] = q->code;
+		memcpy(r + n, q->arg, q->args);
+		n += q->args;
+		cmd_sent = true;
+	}
+	r[0] = n + MAC_SIZE;
+	master_send(f->end + TURNAROUND, r);
+}
+
+/*!
+ *******************************************************************************
+ *  -W option: wait for a master to connect to \a path
+ ******************************************************************************/
+bool radio_bridge(const char *path)
+{
+	struct sockaddr_un sa;
+	int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	strncpy(sa.sun_path, path, sizeof(sa.sun_path) - 1);
+	unlink(path);
+	if (fd < 0 || bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(fd, 1) < 0)
+	{
+		perror(path);
+		return false;
+	}
+	printf("waiting for the master on %s\n", path);
+	fflush(stdout);
+	bridge_fd = accept(fd, NULL, NULL);
+	close(fd);
+	return bridge_fd >= 0;
+}
+
+static void bridge_tx(const rfm12_frame_t *f)
+{
+	uint8_t buf[1+sizeof(wl_header)+RFM12_FRAME_MAX];
+	unsigned k = rfm12_sync(f);
+
+	if (k == 0)
+		return;
+	buf[0] = 0;
+	memcpy(buf + 1, wl_header, sizeof(wl_header));
+	memcpy(buf + 1 + sizeof(wl_header), f->data + k, f->len - k);
+	stats.uplinks++;
+	if (send(bridge_fd, buf, 1 + sizeof(wl_header) + f->len - k, MSG_NOSIGNAL) < 0)
+		perror("bridge");
+}
+
+/*!
+ *******************************************************************************
+ *  des_wait_hook: hold the simulation back to the wall clock, a frame of
+ *  the master goes on the air when it comes in
+ ******************************************************************************/
+static bool bridge_wait(des_time_t t)
+{
+	uint8_t buf[1+RFM12_FRAME_MAX];
+	struct pollfd p = { bridge_fd, POLLIN, 0 };
+	double ahead = (double)t/DES_SECOND - (wall_time() - bridge_wall0);
+	des_time_t start;
+	ssize_t n;
+
+	if (poll(&p, 1, (ahead > 0) ? (int)(ahead*1000) + 1 : 0) <= 0)
+		return false;
+	n = recv(bridge_fd, buf, sizeof(buf), 0);
+	if (n <= 0)
+	{
+		fprintf(stderr, "master has closed the connection\n");
+		exit(1);
+	}
+	start = (des_time_t)((wall_time() - bridge_wall0)*DES_SECOND);
+	if (start < des_now)
+		start = des_now;
+	stats.answers++;
+	rfm12_air(start, buf + 1, n - 1);
+	return true;
+}
+
+/*!
+ *******************************************************************************
+ *  connect the peer to the RFM12 model, right before des_run()
+ ******************************************************************************/
+void radio_start(void)
+{
+	struct tm tm = {
+		.tm_year = 100 + BOOT_YY, .tm_mon = BOOT_MM - 1, .tm_mday = BOOT_DD,
+		.tm_hour = BOOT_hh, .tm_min = BOOT_mm,
+	};
+
+	memset(&stats, 0, sizeof(stats));
+	cmd_pos = 0;
+	cmd_sent = false;
+	epoch = timegm(&tm);
+	if (bridge_fd >= 0)
+	{
+		rfm12_tx_hook = bridge_tx;
+		des_wait_hook = bridge_wait;
+		bridge_wall0 = wall_time();
+	}
+	else if (radio_master)
+	{
+		rfm12_tx_hook = master_tx;
+		rfm12_air_hook = master_air;
+	}
+}
+
+void radio_report(void)
+{
+	printf("radio       %llu frames sent, %llu received (%llu bytes), %llu overruns,"
+		" %llu collisions, %llu missed\n",
+		(unsigned long long)rfm12_stats.tx_frames, (unsigned long long)rfm12_stats.rx_frames,
+		(unsigned long long)rfm12_stats.rx_bytes, (unsigned long long)rfm12_stats.overruns,
+		(unsigned long long)rfm12_stats.collisions, (unsigned long long)rfm12_stats.missed);
+	if (bridge_fd >= 0)
+		printf("bridge      %llu frames to the master, %llu from it\n",
+			(unsigned long long)stats.uplinks, (unsigned long long)stats.answers);
+	else if (radio_master)
+		printf("master      %llu syncs (%llu forced), %llu slave packets, %llu answers,"
+			" %llu retries, %u of %u commands done\n",
+			(unsigned long long)(stats.sync_plain + stats.sync_flags),
+			(unsigned long long)stats.sync_flags, (unsigned long long)stats.uplinks,
+			(unsigned long long)stats.answers, (unsigned long long)stats.retries,
+			cmd_pos, cmd_n);
+}
@@ -0,0 +1,37 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc, libsimavr)
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/radio.h
+ * \brief      the other end of the radio link in the event simulation
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "config.h"
+
+//! a master on the air: time syncs and answers, see radio.c
+extern bool radio_master;
+
+bool radio_command(const char *arg);
+bool radio_bridge(const char *path);
+void radio_start(void);
+void radio_report(void);
@@ -0,0 +1,465 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/rfm12.c
+ * \brief      RFM12 transceiver model behind the SPI of the host build
+ *
+ * Timing is derived from the byte time of the programmed data rate:
+ *  - transmitter: the 16 bit TX register starts with the aa aa preamble
+ *    and shifts out one byte per byte time, RGIT is set while it has room
+ *    for another byte. Bytes still in the register when the transmitter
+ *    is switched off are lost, that is what the two dummy bytes of
+ *    wirelessSendPacket() are for. An empty register repeats its last
+ *    byte, which is harmless before the sync word: the event simulation
+ *    serves the first RGIT only after the main loop pass that switched
+ *    the transmitter on.
+ *  - receiver: with ER and the FIFO fill enabled it waits for a sync word
+ *    that starts after it was armed, then one byte per byte time goes to
+ *    the 2 byte FIFO and sets FFIT. A FIFO read that is more than 2 bytes
+ *    late loses the oldest ones (FFOV). After the frame no more bytes
+ *    arrive, the firmware stops by the length byte.
+ *  - rfm_spi16() leaves nSEL low after every access, so SDO always shows
+ *    FFIT/RGIT. Start-up times of crystal and synthesizer are ignored.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+
+#include "config.h"
+#include "rfm_config.h"
+#include "rfm.h"
+
+#include "des.h"
+#include "rfm12.h"
+
+#define AIR_FRAMES      8
+
+#define PWR_ER          (RFM_POWER_MANAGEMENT_ER & 0xff)
+#define PWR_ET          (RFM_POWER_MANAGEMENT_ET & 0xff)
+#define PWR_EX          (RFM_POWER_MANAGEMENT_EX & 0xff)
+
+#define STATUS_IT       0x8000  //!< FFIT in RX, RGIT in TX
+#define STATUS_POR      RFM_STATUS_POR
+#define STATUS_OV       0x2000  //!< FFOV in RX, RGUR in TX
+#define STATUS_FFEM     RFM_STATUS_FFEM
+
+typedef struct {
+	rfm12_frame_t f;
+	bool heard;
+} air_t;
+
+rfm12_tx_hook_t rfm12_tx_hook;
+rfm12_air_hook_t rfm12_air_hook;
+rfm12_stats_t rfm12_stats;
+
+static air_t air[AIR_FRAMES];
+static uint8_t air_n;
+
+static des_time_t byte_time;
+static uint8_t power;
+static bool fifo_fill;
+static uint16_t latch;
+static bool sdo_high;
+
+/* transmitter, data[] is everything loaded into the register */
+static rfm12_frame_t tx;
+
+/* receiver */
+static bool rx_locked;
+static des_time_t rx_since;        //!< listening with the FIFO armed since
+static des_time_t rx_sync;         //!< end of the sync word
+static uint8_t rx_buf[RFM12_FRAME_MAX];
+static uint8_t rx_len;
+static uint8_t rx_read;
+
+/*!
+ *******************************************************************************
+ *  byte time of a data rate command, 10 MHz / 29 / (R+1) / (1 + cs*7)
+ ******************************************************************************/
+static des_time_t rate_byte_time(uint16_t cmd)
+{
+	return 8*DES_SECOND*29*((cmd & 0x7f) + 1)*((cmd & 0x80) ? 8 : 1)/10000000;
+}
+
+des_time_t rfm12_byte_time(void)
+{
+	return byte_time;
+}
+
+static bool rx_on(void)
+{
+	return (power & PWR_ER) && fifo_fill;
+}
+
+//! bytes completely shifted out of the TX register
+static unsigned tx_sent(void)
+{
+	return (des_now - tx.start)/byte_time;
+}
+
+static bool rgit(void)
+{
+	unsigned sent = tx_sent();
+
+	return sent + 2 > tx.len;
+}
+
+static unsigned rx_avail(void)
+{
+	unsigned n = (des_now - rx_sync)/byte_time;
+
+	return (n < rx_len) ? n : rx_len;
+}
+
+static bool ffit(void)
+{
+	return rx_on() && rx_locked && rx_avail() > rx_read;
+}
+
+static void sdo(void)
+{
+	bool level = (power & PWR_ET) ? rgit() : ffit();
+
+	sdo_high = level;
+	if (level)
+		RFM_SDO_PIN |= _BV(RFM_SDO_BITPOS);
+	else
+		RFM_SDO_PIN &= (uint8_t)~_BV(RFM_SDO_BITPOS);
+}
+
+//! index of the last sync word byte (d4), 0 = none
+static unsigned sync_pos(const rfm12_frame_t *f)
+{
+	unsigned k;
+
+	for (k = 1; k < f->len; k++)
+		if (f->data[k-1] == 0x2d && f->data[k] == 0xd4)
+			return k;
+	return 0;
+}
+
+//! offset of the length byte behind the sync word of \a f, 0 = none
+unsigned rfm12_sync(const rfm12_frame_t *f)
+{
+	unsigned k = sync_pos(f);
+
+	return (k != 0) ? k + 1 : 0;
+}
+
+//! the receiver would lock on \a a, sync word end is returned in \a t
+static bool rx_candidate(const air_t *a, des_time_t *t)
+{
+	unsigned k = sync_pos(&a->f);
+
+	if (a->f.device || k == 0 || a->f.start + (k-1)*byte_time < rx_since)
+		return false;
+	*t = a->f.start + (k+1)*byte_time;
+	return true;
+}
+
+static void rx_lock(const air_t *a)
+{
+	unsigned k = sync_pos(&a->f);
+	bool garbled = false;
+	unsigned i, m;
+
+	rx_sync = a->f.start + (k+1)*byte_time;
+	rx_len = a->f.len - k - 1;
+	rx_read = 0;
+	rx_locked = true;
+	memcpy(rx_buf, a->f.data + k + 1, rx_len);
+	for (i = 0; i < air_n; i++)
+	{
+		if (&air[i] == a)
+			continue;
+		for (m = 0; m < rx_len; m++)
+		{
+			des_time_t t = rx_sync + m*byte_time;
+
+			if (t + byte_time > air[i].f.start && t < air[i].f.end)
+			{
+				rx_buf[m] ^= 0xa5;
+				garbled = true;
+			}
+		}
+	}
+	rfm12_stats.rx_frames++;
+	if (garbled)
+		rfm12_stats.collisions++;
+}
+
+static bool air_add(const rfm12_frame_t *f)
+{
+	if (air_n == AIR_FRAMES)
+		return false;
+	air[air_n].f = *f;
+	air[air_n].heard = false;
+	air_n++;
+	return true;
+}
+
+static void tx_end(void)
+{
+	unsigned sent = tx_sent();
+
+	tx.len = (sent < tx.len) ? sent : tx.len;
+	tx.end = tx.start + tx.len*byte_time;
+	rfm12_stats.tx_frames++;
+	air_add(&tx);
+	if (rfm12_tx_hook != NULL)
+		rfm12_tx_hook(&tx);
+}
+
+static void tx_write(uint8_t b)
+{
+	unsigned sent;
+
+	if (!(power & PWR_ET) || tx.len == RFM12_FRAME_MAX)
+		return;
+	sent = tx_sent();
+	if (sent >= tx.len)
+	{
+		// register ran empty, the chip repeats the last byte: more
+		// preamble before the sync word, a broken frame after it
+		if (sync_pos(&tx) != 0)
+			rfm12_stats.overruns++;
+		while (tx.len <= sent && tx.len < RFM12_FRAME_MAX - 1)
+		{
+			tx.data[tx.len] = tx.data[tx.len-1];
+			tx.len++;
+		}
+		latch |= STATUS_OV;
+	}
+	tx.data[tx.len++] = b;
+}
+
+static uint8_t fifo_read(void)
+{
+	unsigned avail;
+
+	if (!ffit())
+		return 0;
+	avail = rx_avail();
+	if (avail - rx_read > 2)
+	{
+		rx_read = avail - 2;
+		latch |= STATUS_OV;
+		rfm12_stats.overruns++;
+	}
+	rfm12_stats.rx_bytes++;
+	return rx_buf[rx_read++];
+}
+
+static void rx_update(bool was_on)
+{
+	if (!rx_on())
+		rx_locked = false;
+	else if (!was_on)
+	{
+		rx_since = des_now;
+		rx_locked = false;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  one SPI command word, hal_rfm_device
+ ******************************************************************************/
+uint16_t rfm12_spi16(uint16_t cmd)
+{
+	uint16_t ret = 0;
+	bool was_on = rx_on();
+
+	if (cmd == 0x0000)
+	{
+		if ((power & PWR_ET) ? rgit() : ffit())
+			ret |= STATUS_IT;
+		if (!(power & PWR_ET) && !ffit())
+			ret |= STATUS_FFEM;
+		ret |= latch;
+		latch = 0;
+	}
+	else switch (cmd & 0xff00)
+	{
+		case 0xb000:
+			ret = fifo_read();
+			break;
+
+		case 0xb800:
+			tx_write((uint8_t)cmd);
+			break;
+
+		case 0x8200:
+		{
+			uint8_t old = power;
+
+			power = (uint8_t)cmd;
+			if (!(old & PWR_ET) && (power & PWR_ET))
+			{
+				tx.start = des_now;
+				tx.device = true;
+				tx.data[0] = 0xaa;
+				tx.data[1] = 0xaa;
+				tx.len = 2;
+			}
+			else if ((old & PWR_ET) && !(power & PWR_ET))
+				tx_end();
+			rx_update(was_on);
+			break;
+		}
+
+		case 0xca00:
+			fifo_fill = (cmd & (RFM_FIFO_FF & 0xff)) != 0;
+			rx_update(was_on);
+			if (!fifo_fill)
+				rx_locked = false;      // FIFO cleared
+			break;
+
+		case 0xc600:
+			byte_time = rate_byte_time(cmd);
+			break;
+
+		default:
+			break;
+	}
+	sdo();
+	return ret;
+}
+
+/*!
+ *******************************************************************************
+ *  put a frame of a peer on the air, \a data starts with the preamble
+ ******************************************************************************/
+bool rfm12_air(des_time_t start, const uint8_t *data, uint8_t len)
+{
+	rfm12_frame_t f;
+
+	if (len > RFM12_FRAME_MAX)
+		return false;
+	f.start = start;
+	f.end = start + len*byte_time;
+	f.device = false;
+	f.len = len;
+	memcpy(f.data, data, len);
+	return air_add(&f);
+}
+
+/*!
+ *******************************************************************************
+ *  time of the next SDO edge or frame end, UINT64_MAX if there is none
+ ******************************************************************************/
+des_time_t rfm12_next(void)
+{
+	des_time_t best = UINT64_MAX, t;
+	unsigned i;
+
+	// the level follows des_now, an edge is due until SDO shows it, also
+	// when busy time of the CPU has already passed it
+	if (sdo_high)
+		;
+	else if (power & PWR_ET)
+		best = tx.start + (tx.len - 1)*byte_time;
+	else if (rx_on())
+	{
+		if (rx_locked)
+		{
+			if (rx_read < rx_len)
+				best = rx_sync + (rx_read + 1)*byte_time;
+		}
+		else
+		{
+			for (i = 0; i < air_n; i++)
+				if (rx_candidate(&air[i], &t) && t < best)
+					best = t;
+		}
+	}
+	for (i = 0; i < air_n; i++)
+		if (air[i].f.end < best)
+			best = air[i].f.end;
+	return best;
+}
+
+/*!
+ *******************************************************************************
+ *  bring the chip up to des_now: lock on a sync word, let finished frames
+ *  leave the air and update SDO
+ ******************************************************************************/
+void rfm12_fire(void)
+{
+	des_time_t t, first = UINT64_MAX;
+	int lock = -1;
+	unsigned i;
+
+	if (rx_on() && !rx_locked && !(power & PWR_ET))
+	{
+		for (i = 0; i < air_n; i++)
+		{
+			if (rx_candidate(&air[i], &t) && t <= des_now && t < first)
+			{
+				first = t;
+				lock = i;
+			}
+		}
+		if (lock >= 0)
+		{
+			rx_lock(&air[lock]);
+			air[lock].heard = true;
+		}
+	}
+
+	for (i = 0; i < air_n; )
+	{
+		air_t a = air[i];
+
+		if (a.f.end > des_now)
+		{
+			i++;
+			continue;
+		}
+		memmove(&air[i], &air[i+1], (air_n - i - 1)*sizeof(air[0]));
+		air_n--;
+		if (!a.f.device && !a.heard)
+			rfm12_stats.missed++;
+		if (rfm12_air_hook != NULL)
+			rfm12_air_hook(&a.f);
+		i = 0;                      // the hook may have added frames
+	}
+	sdo();
+}
+
+/*!
+ *******************************************************************************
+ *  power-on state, empty air
+ ******************************************************************************/
+void rfm12_reset(void)
+{
+	memset(&rfm12_stats, 0, sizeof(rfm12_stats));
+	air_n = 0;
+	byte_time = rate_byte_time(RFM_SET_DATARATE(RFM_BAUD_RATE));
+	power = PWR_EX;
+	fifo_fill = false;
+	latch = STATUS_POR;
+	tx.len = 0;
+	rx_locked = false;
+	sdo();
+	if (rfm12_air_hook != NULL)
+		rfm12_air_hook(NULL);
+}
@@ -0,0 +1,77 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc, libsimavr)
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/rfm12.h
+ * \brief      RFM12 transceiver model behind the SPI of the host build
+ *
+ * The chip answers the command words of rfm.h (status read, FIFO read,
+ * transmitter register write, power management, FIFO and data rate
+ * settings) and drives the SDO pin with FFIT/RGIT, so rfm.c, wireless.c
+ * and cmac.c run unmodified in the event simulation (des.c).
+ *
+ * Frames are raw byte streams on a shared air, from the first preamble
+ * byte on. The receiver locks on the first 2d d4 sync word that starts
+ * while it listens with the FIFO armed, bytes overlapping another frame
+ * arrive garbled. Peers (radio.c) put their frames on the air and see
+ * the frames the firmware sends through the hooks.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "config.h"
+#include "des.h"
+
+#define RFM12_FRAME_MAX 96         //!< raw bytes of one frame on the air
+
+typedef struct {
+	des_time_t start;              //!< first bit of the preamble
+	des_time_t end;
+	bool device;                   //!< sent by the simulated firmware
+	uint8_t len;
+	uint8_t data[RFM12_FRAME_MAX];
+} rfm12_frame_t;
+
+typedef struct {
+	uint64_t tx_frames;
+	uint64_t rx_frames;            //!< sync word found
+	uint64_t rx_bytes;             //!< read from the FIFO
+	uint64_t overruns;             //!< FIFO overflow and TX register underrun
+	uint64_t collisions;           //!< received frames with garbled bytes
+	uint64_t missed;               //!< peer frames nobody listened to
+} rfm12_stats_t;
+
+//! the firmware has sent \a f
+typedef void (*rfm12_tx_hook_t)(const rfm12_frame_t *f);
+//! \a f has left the air, NULL after reset: the peer may send its next frame
+typedef void (*rfm12_air_hook_t)(const rfm12_frame_t *f);
+
+extern rfm12_tx_hook_t rfm12_tx_hook;
+extern rfm12_air_hook_t rfm12_air_hook;
+extern rfm12_stats_t rfm12_stats;
+
+void rfm12_reset(void);
+uint16_t rfm12_spi16(uint16_t cmd);
+des_time_t rfm12_byte_time(void);
+unsigned rfm12_sync(const rfm12_frame_t *f);
+bool rfm12_air(des_time_t start, const uint8_t *data, uint8_t len);
+des_time_t rfm12_next(void);
+void rfm12_fire(void);
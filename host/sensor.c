@@ -0,0 +1,80 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), simulation
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/sensor.c
+ * \brief      analog front end model: physical value to raw ADC code
+ *
+ * The inverse of the conversions done in adc.c. The NTC curve is modelled
+ * by the calibration points of config.temp_cal_table, so the firmware reads
+ * back the simulated temperature within the ADC quantization.
+ */
+
+#include <stdint.h>
+
+#include "config.h"
+#include "adc.h"
+#include "eeprom.h"
+#include "sensor.h"
+
+static uint16_t clip_adc(int32_t code)
+{
+	if (code < 1)
+		return 1;
+	if (code > 1023)
+		return 1023;
+	return (uint16_t)code;
+}
+
+uint16_t sensor_temp_to_adc(int16_t centidegree)
+{
+	// calibration point j is at code 256+sum(kx_d[0..j]) and 35C-j*5C
+	int32_t kx = TEMP_CAL_OFFSET + kx_d[0];
+	int32_t t = (int32_t)TEMP_CAL_N*TEMP_CAL_STEP;
+	uint8_t i;
+
+	#if TEMP_COMPENSATE_OPTION
+	centidegree -= (int16_t)config.room_temp_offset*10;
+	#endif
+	for (i=1; i<TEMP_CAL_N-1; i++)
+	{
+		if (centidegree > t-TEMP_CAL_STEP)
+			break;
+		kx += kx_d[i];
+		t -= TEMP_CAL_STEP;
+	}
+	// linear segment, extrapolated at both ends, rounded to nearest code
+	return clip_adc(kx + ((t-centidegree)*kx_d[i] + TEMP_CAL_STEP/2) / TEMP_CAL_STEP);
+}
+
+uint16_t sensor_bat_to_adc(uint16_t millivolt)
+{
+	// adc.c: U = 1.1V*1024/ADC
+	if (millivolt == 0)
+		return 1023;
+	return clip_adc((1126400L + millivolt/2) / millivolt);
+}
+
+uint16_t sensor_curr_to_adc(uint16_t milliampere)
+{
+	// adc.c: I = 1.1V*1024/ADC/2.2R
+	if (milliampere == 0)
+		return 1023;
+	return clip_adc(1126400000L / 2200 / milliampere);
+}
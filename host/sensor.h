@@ -0,0 +1,31 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), simulation
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/sensor.h
+ * \brief      analog front end model: physical value to raw ADC code
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+uint16_t sensor_temp_to_adc(int16_t centidegree);
+uint16_t sensor_bat_to_adc(uint16_t millivolt);
+uint16_t sensor_curr_to_adc(uint16_t milliampere);
@@ -0,0 +1,731 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), simulation
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/sim.c
+ * \brief      run the controller core at simulation speed
+ *
+ * Replays the once per second work of the main loop (RTC, ADC sequence,
+ * CTL_update) against a fixed environment as fast as the host can and
+ * reports how many simulated seconds run per wall-clock second.
+ *
+ * With -e the complete firmware main() runs in the discrete-event
+ * simulator (des.c) instead, and the report shows how the CPU time splits
+ * between active and the sleep modes.
+ *
+ * usage: Zero_host [-d days] [-t temperature/0.01C] [-s swing/0.01C] [-b mV]
+ *                  [-e] [-c costfile] [-k seconds:menu|ok|timer] [-m stroke]
+ *                  [-B] [-T] [-p plant_param=value] [-E] [-P state=uA] [-R]
+ *                  [-C config_index=value] [-S samples] [-r field=min:max:step]
+ *                  [-j jobs] [-F] [-f fleet_param=value] [-Q command] [-W socket]
+ *                  [-O trace] [-I trace] [-L] [-N noise/LSB] [-A] [-U step/0.01C]
+ *                  [-D mV/day] [-w]
+ *
+ * -B runs the closed-loop controller benchmark (bench.c) instead, -S
+ * ranks PID tuning candidates with it on -j parallel workers (sweep.c),
+ * -S 0 runs the grid of the -r ranges. -T auto-tunes the PID factors on the
+ * plant first, like the 'U' command does on the device (AUTOTUNE).
+ *
+ * -F simulates a radio network of many slaves on one channel for -d days
+ * (fleet.c).
+ *
+ * -E runs the event simulation and projects the battery life from the
+ * time spent in every power state (energy.c). -C changes a config_t byte
+ * (index as in the 'G'/'S' commands) in the EEPROM before the firmware
+ * starts.
+ *
+ * The event simulation runs wireless.c against an RFM12 model (rfm12.c).
+ * -R puts a master on the air that syncs the time and sends the -Q
+ * commands, -W connects a master process over a socket instead and runs
+ * in real time (radio.c).
+ *
+ * -O writes every ADC conversion of the run to a trace file, -I feeds the
+ * conversions from such a trace instead of the input model (trace.c).
+ * Replay works for every driver, the benchmark and sweep workers each read
+ * the trace from the start.
+ *
+ * -N adds gaussian noise to the temperature conversions, the replay
+ * driver then reports the noise left in temp_average. -U steps the room
+ * temperature after the first hour of the replay driver and reports the
+ * seconds temp_average takes to 50 % and 90 % of the step.
+ *
+ * -L prints the history log of the EEPROM (EEPROM_LOG) at the end of the
+ * run, oldest record first, as the 'H' command reads it from a device.
+ *
+ * -A checks ADC_Convert_To_Degree against the division it replaces
+ * (ADC_CAL_TABLE) for all 1024 ADC codes and all 4096 oversampled codes,
+ * with the default and random calibration tables. Exit code 1 on the
+ * first difference.
+ *
+ * -w checks that the window detection follows the ring of averages for
+ * every window_open/close_detection_time byte the EEPROM can hold, the
+ * values outside the limits of ee_config included. Exit code 1 on the
+ * first failure.
+ *
+ * -D lets the battery voltage of -b fall by mV per simulated day, the
+ * report then shows the days to config.bat_low_thld the firmware
+ * forecasts (BAT_FORECAST).
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include "config.h"
+#include "main.h"
+#include "task.h"
+#include "rtc.h"
+#include "adc.h"
+#include "eeprom.h"
+#include "controller.h"
+#include "keyboard.h"
+
+#include "hal.h"
+#include "sensor.h"
+#include "des.h"
+#include "sim.h"
+#include "bench.h"
+#include "sweep.h"
+#include "fleet.h"
+#include "energy.h"
+#include "radio.h"
+#include "trace.h"
+
+void TIMER2_OVF_vect(void);
+void ADC_vect(void);
+
+int16_t env_temp = 2000;           //!< room temperature [1/100 C]
+int16_t env_swing = 0;             //!< day/night amplitude [1/100 C]
+uint16_t env_bat = 3000;           //!< battery voltage [mV]
+double env_noise = 0;              //!< temperature ADC noise [LSB rms]
+static double env_bat_drop = 0;    //!< battery discharge [mV/day]
+
+static uint32_t noise_state = 1;
+
+/*!
+ *******************************************************************************
+ *  gaussian noise of \ref env_noise rms, sum of 12 uniform numbers
+ *  from a xorshift generator, repeatable from the start of the process
+ ******************************************************************************/
+static double sim_noise(void)
+{
+	double sum = -6.0;
+	uint8_t i;
+
+	for (i=0; i<12; i++)
+	{
+		noise_state ^= noise_state << 13;
+		noise_state ^= noise_state >> 17;
+		noise_state ^= noise_state << 5;
+		sum += noise_state / 4294967296.0;
+	}
+	return sum*env_noise;
+}
+
+/*!
+ *******************************************************************************
+ *  room temperature now, triangle over the day, coldest at midnight
+ ******************************************************************************/
+static int16_t sim_env_temp(void)
+{
+	int16_t m = RTC_GetHour()*60 + RTC_GetMinute();
+	return env_temp - env_swing + (int32_t)env_swing*2*(m<720 ? m : 1440-m)/720;
+}
+
+static des_time_t sim_time;        //!< clock of the once per second driver
+
+/*!
+ *******************************************************************************
+ *  battery voltage now, falls by \ref env_bat_drop per day from \ref env_bat
+ ******************************************************************************/
+static uint16_t sim_env_bat(void)
+{
+	// des_now runs in the event simulation, sim_time in sim_second()
+	double v = env_bat - env_bat_drop*(des_now + sim_time)/(86400.0*DES_SECOND);
+	return (v > 0) ? (uint16_t)v : 0;
+}
+
+static uint16_t sim_adc(uint8_t mux)
+{
+	switch (mux)
+	{
+		case ADC_UB_MUX:
+			return sensor_bat_to_adc(sim_env_bat());
+		case ADC_CURR_MUX:
+			return sensor_curr_to_adc(des_motor_load());
+		case ADC_TEMP_MUX:
+		{
+			int32_t code = sensor_temp_to_adc(sim_env_temp());
+			if (env_noise > 0)
+				code += lround(sim_noise());
+			return (code < 1) ? 1 : ((code > 1023) ? 1023 : code);
+		}
+	}
+	return 0x3ff;
+}
+
+static uint16_t sim_trace_adc(uint8_t mux)
+{
+	// des_now runs in the event simulation, sim_time in sim_second()
+	return trace_adc(des_now + sim_time, mux, sim_adc);
+}
+
+/*!
+ *******************************************************************************
+ *  one RTC second of the main loop
+ ******************************************************************************/
+void sim_second(void)
+{
+	TIMER2_OVF_vect();
+	task &= ~TASK_RTC;
+	RTC_AddOneSecond();
+	RTC_timer_done &= ~(_BV(RTC_TIMER_OVF)|_BV(RTC_TIMER_RTC));
+	CTL_update(RTC_GetSecond()==0);
+
+	// the ADC sleeps through a skipped second (ADC_ADAPTIVE)
+	sleep_with_ADC = false;
+	start_task_ADC();
+	while (sleep_with_ADC)
+	{
+		// the interrupt may keep a conversion burst to itself
+		do
+		{
+			hal_adc_convert();
+			ADC_vect();
+		} while (!(task & TASK_ADC));
+		task &= ~TASK_ADC;
+		sleep_with_ADC = false;
+		task_ADC();
+	}
+	sim_time += DES_SECOND;
+}
+
+/*!
+ *******************************************************************************
+ *  power-on of the controller core for the replay driver
+ ******************************************************************************/
+void sim_start(void)
+{
+	eeprom_config_init(false);
+	RTC_Init();
+	sim_time = 0;
+	trace_rewind();
+	sei();
+}
+
+/*!
+ *******************************************************************************
+ *  -k option: press a key for 300 ms
+ ******************************************************************************/
+static bool sim_key(const char *arg)
+{
+	char *name;
+	double t = strtod(arg, &name);
+	uint8_t key;
+
+	if (*name++ != ':')
+		return false;
+	if (strcmp(name, "menu") == 0)
+		key = KBI_MENU;
+	else if (strcmp(name, "ok") == 0)
+		key = KBI_OK;
+	else if (strcmp(name, "timer") == 0)
+		key = KBI_TIMER;
+	else
+		return false;
+
+	des_key((des_time_t)(t*DES_SECOND), 0xff & ~key);
+	des_key((des_time_t)((t+0.3)*DES_SECOND), 0xff);
+	return true;
+}
+
+/*!
+ *******************************************************************************
+ *  -C option: store a config_t byte in the EEPROM, limited like the
+ *  'S' command of the serial and radio interface
+ ******************************************************************************/
+static bool sim_config(const char *arg)
+{
+	char *eq;
+	unsigned long idx = strtoul(arg, &eq, 0);
+
+	if (*eq != '=' || idx >= CONFIG_RAW_SIZE)
+		return false;
+	eeprom_config_init(false);
+	config_raw[idx] = (uint8_t)strtoul(eq+1, NULL, 0);
+	eeprom_config_save((uint8_t)idx);
+	return true;
+}
+
+static void des_report(double seconds, double wall)
+{
+	uint8_t i;
+
+	printf("simulated %.0f s (%.1f days) in %.3f s wall, %.0f device-days per wall minute\n",
+		seconds, seconds/86400, wall, seconds/86400*60/wall);
+	for (i=0; i<DES_MODES; i++)
+		printf("%-11s %12.3f s %8.4f %%\n", des_mode_name[i],
+			(double)des_stats.time[i]/DES_SECOND, 100.0*des_stats.time[i]/des_now);
+	printf("wakeups     %12llu  %.2f/s\n", (unsigned long long)des_stats.wakeups,
+		des_stats.wakeups/seconds);
+	printf("cycles      %12.0f per hour awake\n",
+		(double)des_stats.time[DES_MODE_ACTIVE]/DES_CYCLE*3600/seconds);
+	#if EVENT_CONTROLLER
+	printf("controller  %12llu of %llu CTL_update calls skipped\n",
+		(unsigned long long)des_stats.ctl_skipped, (unsigned long long)des_stats.irq[DES_IRQ_T2OVF]);
+	#endif
+	#if ADC_ADAPTIVE
+	printf("adc-skip    %12llu of %llu seconds without measurement\n",
+		(unsigned long long)des_stats.adc_skipped, (unsigned long long)des_stats.irq[DES_IRQ_T2OVF]);
+	#endif
+	for (i=0; i<DES_IRQS; i++)
+		printf("%-11s %12llu\n", des_irq_name[i], (unsigned long long)des_stats.irq[i]);
+	printf("adc         %12llu conversions\n", (unsigned long long)des_stats.adc_conversions);
+	printf("motor       %12.3f s, %llu impulses, position %d\n",
+		(double)des_stats.motor_time/DES_SECOND,
+		(unsigned long long)des_stats.motor_impulses, des_motor_pos);
+	for (i=0; i<DES_RFM_STATES; i++)
+		printf("%-11s %12.3f s %8.4f %%\n", des_rfm_name[i],
+			(double)des_stats.rfm_time[i]/DES_SECOND, 100.0*des_stats.rfm_time[i]/des_now);
+}
+
+#if EEPROM_LOG
+/*!
+ *******************************************************************************
+ *  -L option: decode ee_log from the first page boundary after the end
+ *  marker up to the marker, the time counts back from the last record
+ ******************************************************************************/
+static void sim_log_report(void)
+{
+	uint8_t rec[EE_LOG_SIZE][4];   // flags, temperature, valve, absolute
+	unsigned n = 0, pos, end, i;
+	int temp = 0, valve = 0, flags = 0;
+	bool valid = false;
+
+	for (end = 0; end < EE_LOG_SIZE && ee_log[end] != 0xff; end++)
+		;
+	if (end == EE_LOG_SIZE)
+	{
+		printf("log         no end marker\n");
+		return;
+	}
+	pos = (end/EE_LOG_PAGE + 1)*EE_LOG_PAGE % EE_LOG_SIZE;
+	while (pos != end)
+	{
+		uint8_t b = ee_log[pos];
+		if (b >= EE_LOG_END)
+		{
+			// rest of the page is unused
+			if (end/EE_LOG_PAGE == pos/EE_LOG_PAGE && end > pos)
+				pos = end;
+			else
+				pos = (pos/EE_LOG_PAGE + 1)*EE_LOG_PAGE % EE_LOG_SIZE;
+			valid = false;
+			continue;
+		}
+		if (b & EE_LOG_ABS)
+		{
+			flags = b & ~EE_LOG_ABS;
+			temp = ee_log[(pos+1) % EE_LOG_SIZE];
+			valve = ee_log[(pos+2) % EE_LOG_SIZE];
+			pos = (pos+3) % EE_LOG_SIZE;
+			valid = true;
+		}
+		else
+		{
+			temp += (b >> 3) - 8;
+			valve += ((b & 7) - 4) * 2;
+			pos = (pos+1) % EE_LOG_SIZE;
+		}
+		if (!valid)
+			continue;
+		rec[n][0] = flags;
+		rec[n][1] = temp;
+		rec[n][2] = valve;
+		rec[n][3] = (b & EE_LOG_ABS) != 0;
+		n++;
+		flags &= ~EE_LOG_RESTART;
+	}
+	printf("log         %u records, %u bytes, every %u min\n", n, EE_LOG_SIZE, config.log_interval);
+	for (i = 0; i < n; i++)
+		printf("log %6.1f h %5.1f C valve %3u%%%s%s%s%s%s\n",
+			-(double)(n-1-i)*config.log_interval/60,
+			(EE_LOG_TEMP_MIN + rec[i][1]*10)/100.0, rec[i][2],
+			rec[i][3] ? " abs" : "",
+			(rec[i][0] & EE_LOG_WINDOW) ? " window" : "",
+			(rec[i][0] & EE_LOG_AUTO) ? " auto" : "",
+			(rec[i][0] & EE_LOG_ERROR) ? " error" : "",
+			(rec[i][0] & EE_LOG_RESTART) ? " restart" : "");
+}
+#endif
+
+/*!
+ *******************************************************************************
+ *  conversion of the firmware before ADC_CAL_TABLE, \a adc in 1/4 ADC units
+ ******************************************************************************/
+static int16_t sim_cal_reference(int16_t adc)
+{
+	int16_t kx = (TEMP_CAL_OFFSET+(int16_t)kx_d[0])*4;
+	uint8_t i;
+
+	for (i=1; i<TEMP_CAL_N-1 && adc >= kx+kx_d[i]*4; i++)
+		kx += kx_d[i]*4;
+	return (int16_t)(((int32_t)(adc-kx)*(-TEMP_CAL_STEP))/(kx_d[i]*4))
+		+ TEMP_CAL_N*TEMP_CAL_STEP-(i-1)*TEMP_CAL_STEP
+		#if TEMP_COMPENSATE_OPTION
+		+ config.room_temp_offset*10
+		#endif
+		;
+}
+
+/*!
+ *******************************************************************************
+ *  -A option: table conversion against the division, the calibration bytes
+ *  go through eeprom_config_save like a 'S' command
+ ******************************************************************************/
+static int sim_cal_check(void)
+{
+	const uint8_t cal = (uint16_t)(&config.temp_cal_table0)-(uint16_t)(&config);
+	unsigned tables, codes = 0;
+	int16_t adc;
+	uint8_t i;
+
+	eeprom_config_init(false);
+	srand(1);
+	for (tables=0; tables<1000; tables++)
+	{
+		if (tables > 0)
+		{
+			for (i=0; i<TEMP_CAL_N; i++)
+			{
+				config_raw[cal+i] = config_min(cal+i) + rand() % (config_max(cal+i)-config_min(cal+i)+1);
+				eeprom_config_save(cal+i);
+			}
+		}
+		for (adc=0; adc<1024*4; adc++, codes++)
+		{
+			// whole codes as task_ADC passes them without oversampling
+			int16_t code = (adc < 1024) ? adc*4 : adc-1024;
+			if (ADC_Convert_To_Degree(code) != sim_cal_reference(code))
+			{
+				printf("cal table %u code %d/4: %d, division %d\n", tables, code,
+					ADC_Convert_To_Degree(code), sim_cal_reference(code));
+				return 1;
+			}
+		}
+	}
+	printf("cal %u tables, %u codes identical\n", tables, codes);
+	return 0;
+}
+
+/*!
+ *******************************************************************************
+ *  -w option helper: fill the ring of averages with \a ring, set temp_average
+ *  to \a temp and return whether one controller pass opens the window
+ ******************************************************************************/
+static bool sim_window_opens(int16_t ring, int16_t temp)
+{
+	uint8_t i;
+
+	for (i=0; i<AVGS_BUFFER_LEN; i++)
+		ring_buf_temp_avgs[i] = ring;
+	temp_average = temp;
+	CTL_mode_window = 0;
+	CTL_window_minmax();
+	CTL_update(false);
+	return CTL_mode_window != 0;
+}
+
+/*!
+ *******************************************************************************
+ *  -w option: a falling temperature opens the window and a flat one does
+ *  not, without min/max left over from the detection time before
+ ******************************************************************************/
+static int sim_window_check(void)
+{
+	unsigned t;
+
+	sim_start();
+	for (t=0; t<256; t++)
+	{
+		// leave the min/max of a warm ring behind with the default time
+		config.window_open_detection_time = config.window_close_detection_time = 8;
+		sim_window_opens(2600, 2600);
+
+		config.window_open_detection_time = config.window_close_detection_time = t;
+		if (sim_window_opens(2000, 2000))
+		{
+			printf("window detection time %u: opens on a flat temperature\n", t);
+			return 1;
+		}
+		if (!sim_window_opens(2600, 2000))
+		{
+			printf("window detection time %u: stays closed on a drop\n", t);
+			return 1;
+		}
+	}
+	CTL_mode_window = 0;
+	printf("window %u detection times checked\n", t);
+	return 0;
+}
+
+static double wall_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+	double days = 365;
+	uint32_t sec, seconds;
+	double t0, wall;
+	bool events = false, bench = false, energy = false, sweep = false, fleet = false;
+	bool cal_check = false, window_check = false;
+	#if EEPROM_LOG
+	bool history = false;
+	#endif
+	#if AUTOTUNE
+	bool tune = false;
+	#endif
+	uint32_t samples = 0;
+	unsigned jobs = 0;
+	int opt;
+	const char *config_arg[16];
+	const char *bridge = NULL;
+	const char *record = NULL, *replay = NULL;
+	unsigned config_n = 0, i;
+	double err_sum = 0, err_sq = 0;
+	uint32_t err_n = 0;
+	int16_t step = 0, step_base = 0;
+	uint32_t step_t50 = 0, step_t90 = 0;
+
+	while ((opt = getopt(argc, argv, "d:t:s:b:ec:k:m:BTp:EP:RC:S:r:j:Ff:Q:W:O:I:LN:AU:D:w")) != -1)
+	{
+		switch (opt)
+		{
+			case 'd': days = strtod(optarg, NULL); break;
+			case 't': env_temp = atoi(optarg); break;
+			case 's': env_swing = atoi(optarg); break;
+			case 'b': env_bat = atoi(optarg); break;
+			case 'e': events = true; break;
+			case 'c':
+				if (!des_cost_load(optarg))
+					return 2;
+				break;
+			case 'k':
+				if (!sim_key(optarg))
+				{
+					fprintf(stderr, "bad key event %s\n", optarg);
+					return 2;
+				}
+				break;
+			case 'm': des_motor_stroke = atoi(optarg); break;
+			case 'B': bench = true; break;
+			#if AUTOTUNE
+			case 'T': bench = tune = true; break;
+			#endif
+			case 'p':
+				if (!bench_param(optarg))
+				{
+					fprintf(stderr, "bad plant parameter %s\n", optarg);
+					return 2;
+				}
+				break;
+			case 'E': events = energy = true; break;
+			case 'P':
+				if (!energy_param_set(optarg))
+				{
+					fprintf(stderr, "bad power state %s\n", optarg);
+					return 2;
+				}
+				break;
+			case 'R': radio_master = true; break;
+			case 'Q':
+				if (!radio_command(optarg))
+				{
+					fprintf(stderr, "bad radio command %s\n", optarg);
+					return 2;
+				}
+				break;
+			case 'W': bridge = optarg; break;
+			case 'O': record = optarg; break;
+			case 'I': replay = optarg; break;
+			#if EEPROM_LOG
+			case 'L': history = true; break;
+			#endif
+			case 'A': cal_check = true; break;
+			case 'w': window_check = true; break;
+			case 'N': env_noise = strtod(optarg, NULL); break;
+			case 'U': step = atoi(optarg); break;
+			case 'D': env_bat_drop = strtod(optarg, NULL); break;
+			case 'S': sweep = true; samples = strtoul(optarg, NULL, 0); break;
+			case 'r':
+				if (!sweep_range(optarg))
+				{
+					fprintf(stderr, "bad sweep range %s\n", optarg);
+					return 2;
+				}
+				break;
+			case 'j': jobs = atoi(optarg); break;
+			case 'F': fleet = true; break;
+			case 'f':
+				if (!fleet_param(optarg))
+				{
+					fprintf(stderr, "bad fleet parameter %s\n", optarg);
+					return 2;
+				}
+				break;
+			case 'C':
+				if (config_n == sizeof(config_arg)/sizeof(config_arg[0]))
+					return 2;
+				config_arg[config_n++] = optarg;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-d days] [-t temp] [-s swing] [-b mV] [-D mV/day]"
+					" [-e] [-c costfile] [-k sec:key] [-m stroke] [-B] [-T] [-p name=value]"
+					" [-E] [-P state=uA] [-R] [-C index=value]"
+					" [-S samples] [-r field=min:max:step] [-j jobs] [-F] [-f name=value]"
+					" [-Q command] [-W socket] [-O trace] [-I trace] [-L] [-N noise] [-A] [-w] [-U step]\n", argv[0]);
+				return 2;
+		}
+	}
+
+	if (fleet)
+		return fleet_run(days);
+
+	if (record != NULL && (bench || sweep))
+	{
+		fprintf(stderr, "-O records a single run, not a benchmark\n");
+		return 2;
+	}
+	if (record != NULL && !trace_record(record))
+		return 1;
+	if (replay != NULL && !trace_replay(replay))
+		return 1;
+
+	hal_init();
+	hal_adc_source = (record || replay) ? sim_trace_adc : sim_adc;
+	for (i=0; i<config_n; i++)
+	{
+		if (!sim_config(config_arg[i]))
+		{
+			fprintf(stderr, "bad config byte %s\n", config_arg[i]);
+			return 2;
+		}
+	}
+
+	if (cal_check)
+		return sim_cal_check();
+	if (window_check)
+		return sim_window_check();
+	if (sweep)
+		return sweep_run(samples, jobs);
+	#if AUTOTUNE
+	if (tune && !bench_tune())
+		return 1;
+	#endif
+	if (bench)
+		return bench_run();
+
+	if (events)
+	{
+		des_time_t duration = (des_time_t)(days*86400*DES_SECOND);
+
+		if (bridge != NULL && !radio_bridge(bridge))
+			return 1;
+		radio_start();
+		t0 = wall_time();
+		des_run(duration);
+		wall = wall_time()-t0;
+		des_report((double)duration/DES_SECOND, wall);
+		radio_report();
+		if (energy)
+			energy_report((double)duration/DES_SECOND);
+		goto end_state;
+	}
+
+	sim_start();
+
+	seconds = (uint32_t)(days*86400);
+	t0 = wall_time();
+	for (sec=0; sec<seconds; sec++)
+	{
+		if ((step != 0) && (sec == 3600))
+		{
+			step_base = env_temp;
+			env_temp += step;
+		}
+		sim_second();
+		if ((step != 0) && (sec >= 3600))
+		{
+			// rise of temp_average in the direction of the step
+			int32_t rise = (int32_t)(temp_average - step_base) * (step > 0 ? 1 : -1);
+			int16_t size = (step > 0) ? step : -step;
+			if ((step_t50 == 0) && (rise*2 >= size))
+				step_t50 = sec - 3600 + 1;
+			if ((step_t90 == 0) && (rise*10 >= size*9))
+				step_t90 = sec - 3600 + 1;
+		}
+		if (sec >= 60)
+		{
+			// error of temp_average, first minute fills the average
+			double e = temp_average - sim_env_temp();
+			err_sum += e;
+			err_sq += e*e;
+			err_n++;
+		}
+	}
+	wall = wall_time()-t0;
+
+	printf("simulated %u s (%g days) in %.3f s wall\n", seconds, days, wall);
+	printf("rate %.0f simulated seconds per wall second\n", seconds/wall);
+	if (err_n > 0)
+		printf("temp_average error %.2f mean, %.2f standard deviation [1/100 C]\n", err_sum/err_n,
+			sqrt(err_sq/err_n - (err_sum/err_n)*(err_sum/err_n)));
+	if (step != 0)
+		printf("step %d response t50 %u s, t90 %u s\n", step, step_t50, step_t90);
+end_state:
+	printf("end %04u-%02u-%02u %02u:%02u:%02u temp %d wanted %u valve %u error 0x%02x\n",
+		RTC_GetYearYYYY(), RTC_GetMonth(), RTC_GetDay(),
+		RTC_GetHour(), RTC_GetMinute(), RTC_GetSecond(),
+		temp_average, CTL_temp_wanted, valve_wanted, CTL_error);
+	printf("eeprom %u bytes, %u writes\n", hal_eeprom_size(), hal_ee_write_count);
+	#if BAT_FORECAST
+	if (CTL_bat_days == 0xffff)
+		printf("battery %u mV, no forecast\n", bat_average);
+	else
+		printf("battery %u mV, %u days to bat_low_thld\n", bat_average, CTL_bat_days);
+	#endif
+	if (record || replay)
+		printf("trace       %llu recorded, %llu replayed, %llu from the model\n",
+			(unsigned long long)trace_stats.recorded, (unsigned long long)trace_stats.replayed,
+			(unsigned long long)trace_stats.fallback);
+	#if EEPROM_LOG
+	if (history)
+		sim_log_report();
+	#endif
+	trace_close();
+	return 0;
+}
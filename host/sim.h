@@ -0,0 +1,35 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/sim.h
+ * \brief      once per second replay of the controller core (host/sim.c)
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+extern int16_t env_temp;           //!< room temperature [1/100 C]
+extern int16_t env_swing;          //!< day/night amplitude [1/100 C]
+extern uint16_t env_bat;           //!< battery voltage [mV]
+extern double env_noise;           //!< temperature ADC noise [LSB rms]
+
+void sim_start(void);
+void sim_second(void);
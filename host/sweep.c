@@ -0,0 +1,318 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/sweep.c
+ * \brief      parallel parameter sweep of the PID tuning constants
+ *
+ * Every candidate is a set of config_t controller fields. It is written to
+ * the EEPROM and rated with all scenarios of the controller benchmark
+ * (bench.c). The firmware state is global, so candidates run in worker
+ * processes instead of threads: the workers share one job counter and a
+ * result table in anonymous shared memory and every idle worker takes the
+ * next candidate, which balances the load like work stealing does for
+ * independent jobs of unequal length.
+ *
+ * Without samples the grid over all ranges given with -r is run, with
+ * samples every ranged field is drawn at random (fixed seed, repeatable).
+ * Fields without a range keep their ee_config default. Candidate 0 is
+ * always the default configuration.
+ *
+ * Results are ranked by the benchmark score, candidates on the Pareto front
+ * of comfort error against motor impulses are marked with '*'.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "config.h"
+#include "eeprom.h"
+
+#include "bench.h"
+#include "sweep.h"
+
+#define SWEEP_MAX       (1UL<<20)   //!< candidates
+#define SWEEP_SHOW      20          //!< ranked lines printed
+
+typedef struct {
+	const char *name;
+	const char *label;     //!< column title
+	uint8_t idx;           //!< offset in config_t
+	uint8_t min;
+	uint8_t max;
+	uint8_t step;          //!< 0 = keep the default
+} sweep_field_t;
+
+#define SWEEP_FIELD(f, l) { #f, l, offsetof(config_t, f), 0, 0, 0 }
+
+static sweep_field_t fields[] = {
+	SWEEP_FIELD(P3_Factor, "P3"),
+	SWEEP_FIELD(P_Factor, "P"),
+	SWEEP_FIELD(I_Factor, "I"),
+	SWEEP_FIELD(I_max_credit, "Imax"),
+	SWEEP_FIELD(I_credit_expiration, "Iexp"),
+	SWEEP_FIELD(PID_interval, "intv"),
+	SWEEP_FIELD(valve_hysteresis, "hyst"),
+	SWEEP_FIELD(valve_center, "cntr"),
+};
+
+#define SWEEP_FIELDS (sizeof(fields)/sizeof(fields[0]))
+
+typedef struct {
+	uint8_t value[SWEEP_FIELDS];
+	bool done;
+	bool pareto;
+	bench_total_t total;
+} sweep_job_t;
+
+typedef struct {
+	uint32_t next;         //!< next job to take, atomic
+	sweep_job_t job[];
+} sweep_shared_t;
+
+/*!
+ *******************************************************************************
+ *  -r name=value, name=min:max or name=min:max:step
+ ******************************************************************************/
+bool sweep_range(const char *arg)
+{
+	const char *eq = strchr(arg, '=');
+	unsigned min, max, step;
+	uint8_t i;
+	int n;
+
+	if (eq == NULL)
+		return false;
+	n = sscanf(eq+1, "%u:%u:%u", &min, &max, &step);
+	if (n < 1)
+		return false;
+	if (n == 1)
+		max = min;
+	if (n < 3)
+		step = 1;
+	if (max > 255 || min > max || step == 0)
+		return false;
+	for (i=0; i<SWEEP_FIELDS; i++)
+	{
+		if (strlen(fields[i].name) == (size_t)(eq-arg) && strncmp(arg, fields[i].name, eq-arg) == 0)
+		{
+			fields[i].min = min;
+			fields[i].max = max;
+			fields[i].step = step;
+			return true;
+		}
+	}
+	return false;
+}
+
+static uint32_t sweep_steps(const sweep_field_t *f)
+{
+	return f->step ? (f->max - f->min)/f->step + 1 : 1;
+}
+
+/*!
+ *******************************************************************************
+ *  fill the candidate table, \returns number of candidates
+ ******************************************************************************/
+static uint32_t sweep_plan(sweep_job_t *job, uint32_t n, uint32_t samples)
+{
+	uint32_t i, k;
+	uint8_t f;
+
+	for (f=0; f<SWEEP_FIELDS; f++)
+		job[0].value[f] = config_default(fields[f].idx);
+	srand(1);
+	for (i=1; i<n; i++)
+	{
+		k = i-1;
+		for (f=0; f<SWEEP_FIELDS; f++)
+		{
+			uint32_t steps = sweep_steps(&fields[f]);
+			uint32_t s;
+
+			if (fields[f].step == 0)
+			{
+				job[i].value[f] = job[0].value[f];
+				continue;
+			}
+			if (samples)
+				s = (uint32_t)rand() % steps;
+			else
+			{
+				s = k % steps;
+				k /= steps;
+			}
+			job[i].value[f] = fields[f].min + s*fields[f].step;
+		}
+	}
+	return n;
+}
+
+/*!
+ *******************************************************************************
+ *  worker process: take jobs until none is left
+ ******************************************************************************/
+static void sweep_worker(sweep_shared_t *sh, uint32_t n)
+{
+	uint32_t i;
+	uint8_t f;
+
+	eeprom_config_init(false);
+	while ((i = __atomic_fetch_add(&sh->next, 1, __ATOMIC_RELAXED)) < n)
+	{
+		sweep_job_t *j = &sh->job[i];
+
+		for (f=0; f<SWEEP_FIELDS; f++)
+		{
+			config_raw[fields[f].idx] = j->value[f];
+			eeprom_config_save(fields[f].idx);
+		}
+		j->done = bench_eval(&j->total);
+	}
+}
+
+static const uint8_t *sweep_default;
+
+static int sweep_cmp(const void *a, const void *b)
+{
+	const sweep_job_t *x = *(sweep_job_t * const *)a;
+	const sweep_job_t *y = *(sweep_job_t * const *)b;
+
+	if (x->done != y->done)
+		return x->done ? -1 : 1;
+	return (x->total.score > y->total.score) - (x->total.score < y->total.score);
+}
+
+static void sweep_print(uint32_t rank, const sweep_job_t *j)
+{
+	uint8_t f;
+
+	printf("%5u %9.1f %9.2f %8u %c", rank, j->total.score, j->total.comfort,
+		j->total.impulses, j->pareto ? '*' : ' ');
+	for (f=0; f<SWEEP_FIELDS; f++)
+		printf(" %4u", j->value[f]);
+	printf("%s\n", (j->value == sweep_default) ? "  default" : "");
+}
+
+/*!
+ *******************************************************************************
+ *  run the sweep on \a jobs worker processes and print the ranking
+ ******************************************************************************/
+int sweep_run(uint32_t samples, unsigned jobs)
+{
+	sweep_shared_t *sh;
+	sweep_job_t **rank;
+	size_t size;
+	uint32_t n = 1, i, k;
+	uint8_t f;
+
+	if (samples)
+		n += samples;
+	else
+	{
+		uint32_t grid = 1;
+		for (f=0; f<SWEEP_FIELDS; f++)
+		{
+			grid *= sweep_steps(&fields[f]);
+			if (grid > SWEEP_MAX)
+				break;
+		}
+		n += grid;
+	}
+	if (n > SWEEP_MAX)
+	{
+		fprintf(stderr, "sweep: more than %lu candidates\n", SWEEP_MAX);
+		return 2;
+	}
+
+	size = sizeof(sweep_shared_t) + n*sizeof(sweep_job_t);
+	sh = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (sh == MAP_FAILED)
+		return 1;
+	memset(sh, 0, size);
+	sweep_plan(sh->job, n, samples);
+	sweep_default = sh->job[0].value;
+
+	if (jobs == 0)
+		jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	if (jobs > n)
+		jobs = n;
+	fflush(stdout);
+	for (i=0; i<jobs; i++)
+	{
+		pid_t pid = fork();
+		if (pid < 0)
+			return 1;
+		if (pid == 0)
+		{
+			sweep_worker(sh, n);
+			_exit(0);
+		}
+	}
+	while (wait(NULL) > 0)
+		;
+
+	// Pareto front: no other candidate is at least as good in both
+	for (i=0; i<n; i++)
+	{
+		sweep_job_t *a = &sh->job[i];
+
+		a->pareto = a->done;
+		for (k=0; k<n && a->pareto; k++)
+		{
+			sweep_job_t *b = &sh->job[k];
+
+			if (b->done && b->total.comfort <= a->total.comfort && b->total.impulses <= a->total.impulses
+				&& (b->total.comfort < a->total.comfort || b->total.impulses < a->total.impulses))
+				a->pareto = false;
+		}
+	}
+
+	rank = malloc(n*sizeof(*rank));
+	if (rank == NULL)
+		return 1;
+	for (i=0; i<n; i++)
+		rank[i] = &sh->job[i];
+	qsort(rank, n, sizeof(*rank), sweep_cmp);
+
+	printf("%u candidates on %u workers\n", n, jobs);
+	printf("%5s %9s %9s %8s  ", "rank", "score", "comfort", "impulses");
+	for (f=0; f<SWEEP_FIELDS; f++)
+		printf(" %4s", fields[f].label);
+	printf("\n");
+	for (i=0; i<n; i++)
+	{
+		if (i < SWEEP_SHOW || rank[i] == &sh->job[0])
+		{
+			if (i >= SWEEP_SHOW)
+				printf("  ...\n");
+			sweep_print(i+1, rank[i]);
+		}
+	}
+
+	free(rank);
+	munmap(sh, size);
+	return 0;
+}
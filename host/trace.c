@@ -0,0 +1,243 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/trace.c
+ * \brief      record and replay of raw ADC conversion results
+ *
+ * The trace is streamed in both directions, a year of conversions does not
+ * have to fit in memory. Replay reads ahead only as far as the time of the
+ * conversion asked for.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "adc.h"
+#include "des.h"
+#include "hal.h"
+#include "trace.h"
+
+#define TRACE_US        (DES_SECOND/1000000)
+
+static const struct {
+	uint8_t mux;
+	const char *name;
+} channels[] = {
+	{ ADC_UB_MUX,   "ub" },
+	{ ADC_CURR_MUX, "curr" },
+	{ ADC_TEMP_MUX, "temp" },
+};
+
+#define CHANNELS (sizeof(channels)/sizeof(channels[0]))
+
+typedef struct {
+	uint64_t us;
+	uint8_t ch;
+	uint16_t adc;
+} trace_line_t;
+
+trace_stats_t trace_stats;
+
+static FILE *trace_file;
+static const char *trace_path;
+static bool replay;
+static unsigned long line_no;
+
+static trace_line_t ahead;         //!< next unread line of the replay
+static bool ahead_valid;
+
+static struct {
+	bool valid;
+	bool used;                     //!< already served to a conversion
+	uint64_t us;
+	uint16_t adc;
+} held[CHANNELS];
+
+static int channel_index(uint8_t mux)
+{
+	unsigned i;
+
+	for (i=0; i<CHANNELS; i++)
+		if (channels[i].mux == mux)
+			return (int)i;
+	return -1;
+}
+
+/*!
+ *******************************************************************************
+ *  read the next sample line into "ahead", exits on a malformed line
+ ******************************************************************************/
+static void read_ahead(void)
+{
+	char buf[80], name[8];
+	unsigned long long us;
+	unsigned adc, i;
+
+	ahead_valid = false;
+	while (fgets(buf, sizeof(buf), trace_file) != NULL)
+	{
+		line_no++;
+		if (buf[0] == '#' || buf[0] == '\n')
+			continue;
+		if (sscanf(buf, "%llu %7s %u", &us, name, &adc) != 3 || adc > 0x3ff)
+			break;
+		for (i=0; i<CHANNELS; i++)
+			if (strcmp(name, channels[i].name) == 0)
+				break;
+		if (i == CHANNELS || us < ahead.us)
+			break;
+		ahead.us = us;
+		ahead.ch = (uint8_t)i;
+		ahead.adc = (uint16_t)adc;
+		ahead_valid = true;
+		return;
+	}
+	if (ferror(trace_file) || !feof(trace_file))
+	{
+		fprintf(stderr, "%s:%lu: bad trace line\n", trace_path, line_no);
+		exit(1);
+	}
+}
+
+static void take_ahead(void)
+{
+	held[ahead.ch].valid = true;
+	held[ahead.ch].used = false;
+	held[ahead.ch].us = ahead.us;
+	held[ahead.ch].adc = ahead.adc;
+	read_ahead();
+}
+
+/*!
+ *******************************************************************************
+ *  open the trace for reading, also used by trace_rewind()
+ ******************************************************************************/
+static bool replay_open(void)
+{
+	trace_file = fopen(trace_path, "r");
+	if (trace_file == NULL)
+	{
+		perror(trace_path);
+		return false;
+	}
+	memset(held, 0, sizeof(held));
+	ahead.us = 0;
+	line_no = 0;
+	read_ahead();
+	return true;
+}
+
+/*!
+ *******************************************************************************
+ *  -O option: write every conversion of the run to \a path
+ ******************************************************************************/
+bool trace_record(const char *path)
+{
+	trace_file = fopen(path, "w");
+	if (trace_file == NULL)
+	{
+		perror(path);
+		return false;
+	}
+	trace_path = path;
+	replay = false;
+	fprintf(trace_file, "# Zero ADC trace: time [us], channel, ADCW\n");
+	return true;
+}
+
+/*!
+ *******************************************************************************
+ *  -I option: serve the conversions from the trace at \a path
+ ******************************************************************************/
+bool trace_replay(const char *path)
+{
+	trace_path = path;
+	replay = true;
+	return replay_open();
+}
+
+/*!
+ *******************************************************************************
+ *  start the replay over, called by every run of the controller core
+ *
+ *  The file is opened again instead of seeking, forked benchmark workers
+ *  must not share the file offset.
+ ******************************************************************************/
+void trace_rewind(void)
+{
+	if (!replay || trace_file == NULL)
+		return;
+	fclose(trace_file);
+	if (!replay_open())
+		exit(1);
+}
+
+/*!
+ *******************************************************************************
+ *  conversion of channel \a mux at time \a t, replaces hal_adc_source
+ *
+ *  Samples older than \a t are only held. Samples of the same instant are
+ *  handed out one per conversion in trace order, so repeated readings of
+ *  the noise filter in task_ADC() come back in sequence.
+ ******************************************************************************/
+uint16_t trace_adc(des_time_t t, uint8_t mux, hal_adc_source_t model)
+{
+	uint64_t us = t / TRACE_US;
+	int c = channel_index(mux);
+	uint16_t adc;
+
+	if (trace_file == NULL || c < 0)
+		return model(mux);
+	if (!replay)
+	{
+		adc = model(mux) & 0x3ff;
+		fprintf(trace_file, "%llu %s %u\n", (unsigned long long)us,
+			channels[c].name, adc);
+		trace_stats.recorded++;
+		return adc;
+	}
+
+	while (ahead_valid && ahead.us < us)
+		take_ahead();
+	while (ahead_valid && ahead.us == us
+		&& !(held[c].valid && held[c].us == us && !held[c].used))
+		take_ahead();
+
+	if (!held[c].valid)
+	{
+		trace_stats.fallback++;
+		return model(mux);
+	}
+	held[c].used = true;
+	trace_stats.replayed++;
+	return held[c].adc;
+}
+
+void trace_close(void)
+{
+	if (trace_file == NULL)
+		return;
+	if (fclose(trace_file) != 0)
+		perror(trace_path);
+	trace_file = NULL;
+}
@@ -0,0 +1,58 @@
+/*
+ *  Open HR20 - host simulation
+ *
+ *  target:     build machine (Linux, gcc), ATmega169 register stubs
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host/trace.h
+ * \brief      record and replay of raw ADC conversion results
+ *
+ * A trace is a text file with one conversion per line:
+ *
+ *     <time [us]> <channel> <ADCW>
+ *
+ * channel is "ub", "curr" or "temp" (ADC_UB_MUX, ADC_CURR_MUX,
+ * ADC_TEMP_MUX), lines starting with '#' are comments. Lines are sorted by
+ * time, conversions of the same instant keep the order in which the
+ * firmware read them.
+ *
+ * Replay holds the last sample of a channel until the next one is due, a
+ * channel the trace does not contain falls back to the input model. A run
+ * of the same firmware against its own recording reads every ADCW again.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "des.h"
+#include "hal.h"
+
+typedef struct {
+	uint64_t recorded;
+	uint64_t replayed;
+	uint64_t fallback;   //!< conversions served by the input model
+} trace_stats_t;
+
+extern trace_stats_t trace_stats;
+
+bool trace_record(const char *path);
+bool trace_replay(const char *path);
+void trace_rewind(void);
+uint16_t trace_adc(des_time_t t, uint8_t mux, hal_adc_source_t model);
+void trace_close(void);
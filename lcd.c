@@ -648,7 +648,7 @@ void LCD_SetHourBarSeg(uint8_t seg, uint8_t mode)
  ******************************************************************************/
 void LCD_HourBarBitmap(uint32_t bitmap)
 {
-	#if 0
+	#if HOST_SIM
 	uint8_t i;
 	for (i=0;i<24;i++)
 	{
@@ -967,13 +967,13 @@ void task_lcd_update(void)
  *
  ******************************************************************************/
 
-// not optimized
-/*ISR(LCD_vect)
+#if HOST_SIM
+// not optimized, the host build has no AVR assembler
+ISR(LCD_vect)
 {
 	task |= TASK_LCD;
 }
-*/
-
+#else
 // optimized
 ISR_NAKED ISR (LCD_vect)
 {
@@ -985,4 +985,5 @@ ISR_NAKED ISR (LCD_vect)
 		::"I" (_SFR_IO_ADDR(task)) , "I" (TASK_LCD_BIT)
 	);
 }
+#endif
 
@@ -68,7 +68,11 @@
 // uint8_t valve_wanted=0;
 
 // prototypes
+#if HOST_SIM
+int firmware_main(void);                   // started by host/des.c, leaves by longjmp()
+#else
 int main(void);                            // main with main loop
+#endif
 static inline void init(void);                           // init the whole thing
 void load_defauls(void);                   // load default values
                                            // (later from eeprom using config.c)
@@ -88,8 +92,12 @@ bool reboot = false;
  *******************************************************************************
  * main program
  ******************************************************************************/
+#if HOST_SIM
+int firmware_main(void)
+#else
 int __attribute__ ((noreturn)) main(void)
 // __attribute__((noreturn)) mean that we not need prologue and epilogue for main()
+#endif
 {
 	//! initalization
 	init();
@@ -130,7 +138,7 @@ int __attribute__ ((noreturn)) main(void)
 	ADCSRA |= (1<<ADSC);
 
 		// go to sleep with ADC conversion start
-		asm volatile ("cli");
+		cli();
 		if (! task && ((ASSR & (_BV(OCR2UB)|_BV(TCN2UB)|_BV(TCR2UB))) == 0))			// ATmega169 datasheet chapter 17.8.1
 		{
   		// nothing to do, go to sleep
@@ -157,16 +165,16 @@ int __attribute__ ((noreturn)) main(void)
 				ADCSRA |= (1<<ADSC);
 			}
 
-			asm volatile ("sei");							//  sequence from ATMEL datasheet chapter 6.8.
-			asm volatile ("sleep");
-			asm volatile ("nop");
+			sei();							//  sequence from ATMEL datasheet chapter 6.8.
+			sleep_cpu();
+			nop();
 
 			SMCR = (1<<SM1)|(1<<SM0)|(0<<SE);	// Disable Power-save mode
 			
 		}
 		else
 		{
-			asm volatile ("sei");
+			sei();
 		}
 
 		// RFM12
@@ -238,6 +246,11 @@ int __attribute__ ((noreturn)) main(void)
 				sei();
 				bool minute=(RTC_GetSecond()==0);
 				CTL_update(minute);
+				#if MOTOR_COALESCE
+				// without it nothing moves the valve to valve_wanted,
+				// see the disabled MOTOR_Goto() below
+				MOTOR_Schedule(valve_wanted);
+				#endif
 				if (minute)
 				{
 					if (((CTL_error &  (CTL_ERR_BATT_LOW | CTL_ERR_BATT_WARNING)) == 0) && (RTC_GetDayOfWeek()==6) && (RTC_GetHour()==10) && (RTC_GetMinute()==0))
@@ -253,15 +266,8 @@ int __attribute__ ((noreturn)) main(void)
 
 				if ((config.RFM_devaddr!=0) && (time_sync_tmo>1))
 				{
-					if (((RTC_GetSecond() == config.RFM_devaddr) && (wireless_buf_ptr)) ||
-					(
-						(
-								(RTC_GetSecond()>30) && ((RTC_GetSecond()&1) ? (wl_force_addr1==config.RFM_devaddr) : (wl_force_addr2==config.RFM_devaddr))
-								) || (
-								(wl_force_addr1==0xff) && (RTC_GetSecond()%30 == config.RFM_devaddr) && ((wl_force_flags>>config.RFM_devaddr)&1)
-								)
-						)
-					) // collission protection: every HR20 shall send when the second counter is equal to it's own address.
+					if (wireless_tx_slot(RTC_GetSecond(), config.RFM_devaddr, wireless_buf_ptr != 0,
+						wl_force_addr1, wl_force_addr2, wl_force_flags)) // collission protection: every HR20 shall send when the second counter is equal to it's own address.
 					{
 						wirelessTimerCase = WL_TIMER_FIRST;
 						RTC_timer_set(RTC_TIMER_RFM, WLTIME_START);
@@ -336,7 +342,9 @@ int __attribute__ ((noreturn)) main(void)
 
 // default fuses for ELF file
 
-#ifdef FUSE_BOOTSZ0
+#if HOST_SIM
+	// no fuses on the host build
+#elif defined(FUSE_BOOTSZ0)
 FUSES =
 {
     .low = (uint8_t)(FUSE_CKSEL0 & FUSE_CKSEL2 & FUSE_CKSEL3 & FUSE_SUT0 & FUSE_CKDIV8),  //0x62
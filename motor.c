@@ -75,6 +75,18 @@ static volatile uint16_t longest_low_eye = 0;
 
 static void MOTOR_Control(motor_dir_t); // control H-bridge of motor
 
+#if MOTOR_COALESCE
+uint8_t MOTOR_sched_pos = 0xff;   //!< last position given to MOTOR_Goto, 0xff = none yet
+uint16_t MOTOR_sched_runs;        //!< motor runs started by MOTOR_Schedule
+uint16_t MOTOR_sched_cancelled;   //!< windows ended by a reversal to MOTOR_sched_pos
+uint16_t MOTOR_sched_dropped;     //!< windows ended with less than the minimum travel
+uint16_t MOTOR_start_cost;        //!< start-up of one run [timer0 ticks, 1/15625 sec]
+static uint16_t motor_sched_timer; // seconds to the end of the window, 0 = none open
+static bool motor_sched_retry;    // motor_sched_timer only waits for a busy motor
+static volatile uint16_t motor_first_impulse; // timer0 ticks from start to the first impulse
+static int16_t motor_run_start;   // MOTOR_PosAct at the start of the run
+#endif
+
 static uint8_t MOTOR_wait_for_new_calibration = 5;
 
 
@@ -106,6 +118,10 @@ void MOTOR_updateCalibration(uint8_t cal_type)
 		#endif
 		CTL_integratorBlock = DEFINE_INTEGRATOR_BLOCK;
 		CTL_interatorCredit = config.I_max_credit;
+		#if MOTOR_COALESCE
+		// calibration ends fully open, the next request has to run
+		MOTOR_sched_pos = 0xff;
+		#endif
 		
 	}
 	else
@@ -201,6 +217,108 @@ void MOTOR_Goto(uint8_t percent)
 	}
 }
 
+#if MOTOR_COALESCE
+/*!
+ *******************************************************************************
+ * start-up cost of the run that has just stopped
+ *
+ * \note the first impulse of a run takes longer than the following ones,
+ *       the motor and gear have to start. The difference to the last
+ *       impulse is averaged in \ref MOTOR_start_cost.
+ ******************************************************************************/
+static void motor_start_cost_update(void)
+{
+	int16_t n = MOTOR_PosAct - motor_run_start;
+	int16_t cost = 0;
+
+	if ((n < 2) && (n > -2))
+		return;  // no steady impulse to compare with
+	if (motor_first_impulse > motor_diag)
+		cost = motor_first_impulse - motor_diag;
+	MOTOR_start_cost += (cost - (int16_t)MOTOR_start_cost) / 4;
+}
+
+/*!
+ *******************************************************************************
+ * smallest motor run in percent
+ *
+ * \note a run shorter than MOTOR_start_cost/motor_diag impulses spends more
+ *       energy on the start-up than on the travel
+ ******************************************************************************/
+static uint8_t motor_min_travel(void)
+{
+	uint8_t min = config.motor_min_travel;
+
+	if ((motor_diag != 0) && (MOTOR_PosMax >= MOTOR_MIN_IMPULSES))
+	{
+		uint32_t d = (uint32_t)motor_diag * MOTOR_PosMax;
+		uint16_t p = ((uint32_t)MOTOR_start_cost * 100 + d - 1) / d;
+		if (p > 50)
+			p = 50;
+		if (p > min)
+			min = p;
+	}
+	return min;
+}
+
+/*!
+ *******************************************************************************
+ * valve request of the controller, drives the motor through MOTOR_Goto
+ *
+ * \param  percent desired endposition 0-100
+ *
+ * \note call it once per second. A request that differs from the last
+ *       position opens a window of config.motor_window minutes, later
+ *       requests replace it. A reversal to the last position cancels the
+ *       window, at its end the motor runs only for the minimum travel.
+ *       Steps of four times the minimum travel run at once.
+ ******************************************************************************/
+void MOTOR_Schedule(uint8_t percent)
+{
+	uint8_t travel, min;
+
+	if (percent == MOTOR_sched_pos)
+	{
+		if ((motor_sched_timer != 0) && !motor_sched_retry)
+			MOTOR_sched_cancelled++;
+		motor_sched_timer = 0;
+		motor_sched_retry = false;
+		return;
+	}
+	travel = (percent > MOTOR_sched_pos) ? (percent - MOTOR_sched_pos) : (MOTOR_sched_pos - percent);
+	min = motor_min_travel();
+	if ((MOTOR_sched_pos != 0xff) && (config.motor_window != 0) && (travel < 4 * min))
+	{
+		if (motor_sched_timer == 0)
+		{
+			motor_sched_timer = (uint16_t)config.motor_window * 60;
+			motor_sched_retry = false;
+		}
+		if (--motor_sched_timer != 0)
+			return;
+		if (travel < min)
+		{
+			MOTOR_sched_dropped++;
+			return;  // next request opens a new window
+		}
+	}
+	if (!MOTOR_IsCalibrated() || (MOTOR_Dir != stop) || MOTOR_eye_test())
+	{
+		if (motor_sched_timer == 0)
+		{
+			motor_sched_timer = 1;  // motor is busy, try again next second
+			motor_sched_retry = true;
+		}
+		return;
+	}
+	motor_sched_timer = 0;
+	motor_sched_retry = false;
+	MOTOR_sched_pos = percent;
+	MOTOR_sched_runs++;
+	MOTOR_Goto(percent);
+}
+#endif
+
 #if 0
 /*!
  *******************************************************************************
@@ -256,6 +374,10 @@ static void MOTOR_Control(motor_dir_t direction)
 			MOTOR_eye_enable();
 			motor_diag_cnt=0; last_eye_change=0; longest_low_eye = 0; 
 			motor_diag_ignore = MOTOR_IGNORE_IMPULSES;
+			#if MOTOR_COALESCE
+			motor_first_impulse = 0;
+			motor_run_start = MOTOR_PosAct;
+			#endif
 			MOTOR_Dir_Counter = (MOTOR_Dir = direction);
 			motor_max_time_for_impulse = ((uint16_t)config.motor_speed * ((MOTOR_IsCalibrated())?(uint16_t)config.motor_end_detect_run:(uint16_t)config.motor_end_detect_cal) / 100)<<3;
 			motor_timer = motor_max_time_for_impulse<<2; // *4 (for motor start-up)
@@ -326,6 +448,10 @@ void MOTOR_timer_stop(void)
 				MOTOR_calibration_step = -1;     // calibration error
 				CTL_set_error(CTL_ERR_MOTOR);
 			}
+			#if MOTOR_COALESCE
+			else
+				motor_start_cost_update();
+			#endif
 	}
 	else
 	{ // stop on timeout
@@ -428,6 +554,10 @@ void MOTOR_interrupt(uint8_t pine)
 					#if DEBUG_MOTOR_COUNTER
 						MOTOR_counter++;
 					#endif
+					#if MOTOR_COALESCE
+					if (motor_first_impulse == 0)
+						motor_first_impulse = motor_diag_cnt;
+					#endif
 
 					motor_diag = motor_diag_cnt;
 					longest_low_eye = 0;
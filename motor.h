@@ -102,14 +102,25 @@ uint8_t MOTOR_GetPosPercent(void);  // get percental position of motor (0-100%)
 void MOTOR_timer_stop(void);
 void MOTOR_timer_pulse(void);
 void MOTOR_interrupt(uint8_t pine);
+#if MOTOR_COALESCE
+void MOTOR_Schedule(uint8_t percent);
+#endif
 
 #define timer0_need_clock() (TCCR0A & ((1<<CS02)|(1<<CS01)|(1<<CS00)))
 
 extern volatile int16_t MOTOR_PosAct;
+extern int16_t MOTOR_PosMax;
 extern volatile uint16_t motor_diag;
 extern int8_t MOTOR_calibration_step;
 extern uint16_t motor_diag_count;
 extern motor_dir_t MOTOR_Dir;          //!< actual direction
 extern volatile uint8_t MOTOR_PosOvershoot;
 extern uint32_t MOTOR_counter;         //!< count volume of motor pulses for dianostic
+#if MOTOR_COALESCE
+extern uint8_t MOTOR_sched_pos;
+extern uint16_t MOTOR_sched_runs;
+extern uint16_t MOTOR_sched_cancelled;
+extern uint16_t MOTOR_sched_dropped;
+extern uint16_t MOTOR_start_cost;
+#endif
 
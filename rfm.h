@@ -37,7 +37,13 @@
 #pragma once // multi-iclude prevention. gcc knows this pragma
 #if RFM
 
+#if HOST_SIM
+// the host simulation decodes the commands instead of the port pins (host/hal.c)
+uint16_t hal_rfm_spi16(uint16_t outval);
+#define RFM_SPI_16(OUTVAL)			hal_rfm_spi16(OUTVAL)
+#else
 #define RFM_SPI_16(OUTVAL)			rfm_spi16(OUTVAL) //<! a function that gets a uint16_t (clocked out value) and returns a uint16_t (clocked in value)
+#endif
 
 #define RFM_SPI_SELECT        		(RFM_NSEL_PORT &= ~_BV(RFM_NSEL_BITPOS))
 #define RFM_SPI_DESELECT      		(RFM_NSEL_PORT |= _BV(RFM_NSEL_BITPOS))
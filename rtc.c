@@ -353,6 +353,50 @@ uint8_t RTC_ActualTimerTemperatureType(bool exact)
     return (data >> 12) & 3;
 }
 
+#if OPTIMUM_START
+/*!
+ *******************************************************************************
+ *
+ *  get next switch point from timers, today or tomorrow
+ *  
+ *  \param *minutes_ahead returns the minutes from now to the switch point
+ *
+ *  \returns temperature type, TEMP_TYPE_INVALID if there is none
+ *
+ ******************************************************************************/
+
+uint8_t RTC_NextTimerTemperatureType(uint16_t *minutes_ahead)
+{
+    uint16_t minutes = RTC.hh*60 + RTC.mm;
+    uint8_t dow = ((config.timer_mode==1)?RTC.DOW:0);
+    uint16_t offset = 0;
+    uint8_t day;
+    for (day=0;day<2;day++) {
+        uint8_t idx_raw = timers_get_raw_index(dow,0);
+        uint8_t stop = idx_raw+RTC_TIMERS_PER_DOW;
+        uint16_t mintime = 24*60;
+        uint16_t data = 0;
+        // first timer after actual time
+        for (; idx_raw<stop; idx_raw++){
+            uint16_t raw = eeprom_timers_read_raw(idx_raw);
+            uint16_t table_time = raw & 0x0fff;
+            if (table_time>=24*60) continue;
+            if ((table_time < mintime) && (table_time+offset > minutes)) {
+                mintime = table_time;
+                data = raw;
+            }
+        }
+        if (mintime<24*60) {
+            *minutes_ahead = mintime+offset-minutes;
+            return (data >> 12) & 3;
+        }
+        if (dow>0) dow=(dow%7)+1;
+        offset=24*60;
+    }
+    return TEMP_TYPE_INVALID;
+}
+#endif
+
 
 /*!
  *******************************************************************************
@@ -600,14 +644,14 @@ void RTC_timer_set(uint8_t timer_id, uint8_t time) {
 	*
 	******************************************************************************/
 	
-	// not optimized
-	/*ISR(TIMER2_OVF_vect)
+#if HOST_SIM
+	// not optimized, the host build has no AVR assembler
+	ISR(TIMER2_OVF_vect)
 	{
 		task |= TASK_RTC;   // increment second and check Dow_Timer
 		RTC_timer_done |= _BV(RTC_TIMER_OVF) | _BV(RTC_TIMER_RTC);
 	}
-	*/
-
+#else
 	// optimized
 	ISR_NAKED ISR (TIMER2_OVF_vect)
 	{
@@ -632,6 +676,7 @@ void RTC_timer_set(uint8_t timer_id, uint8_t time) {
 			::"I" (_SFR_IO_ADDR(task)) , "I" (TASK_RTC_BIT), "M" (_BV(RTC_TIMER_OVF)|_BV(RTC_TIMER_RTC))
 		);
 	} 
+#endif
 
 	extern bool kbtimeout;
 	/*!
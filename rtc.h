@@ -50,10 +50,16 @@
 #define RTC_TIMER_RFM 2
 #define RTC_TIMERS 2
 #define RTC_TIMER_CALC(t) ((uint8_t)((t*256L)/1000L))
-// only for DEBUG build
+//! RTC second is 1/16s, only for DEBUG build
+#ifndef RTC_DEBUG_FAST
+	#define RTC_DEBUG_FAST 1
+#endif
+#if RTC_DEBUG_FAST
 #define TCCR2A_INIT ((0<<CS22) | (1<<CS21) |(0<<CS20))     // select precaler: 32.768 kHz / 8
-//#define TCCR2A_INIT ((1<<CS22) | (1<<CS20))     // select precaler: 32.768 kHz / 128 =
+#else
+#define TCCR2A_INIT ((1<<CS22) | (1<<CS20))     // select precaler: 32.768 kHz / 128 =
                                         // => 1 sec between each overflow
+#endif
 //! Do we support calibrate_rco
 #define	HAS_CALIBRATE_RCO     1
 
@@ -119,6 +125,9 @@ void RTC_SetYear(uint8_t);                     // Set year
 bool RTC_DowTimerSet(rtc_dow_t, uint8_t, uint16_t, timermode_t timermode); // set day of week timer
 uint16_t RTC_DowTimerGet(rtc_dow_t dow, uint8_t slot, timermode_t *timermode);
 uint8_t RTC_ActualTimerTemperatureType(bool exact);
+#if OPTIMUM_START
+uint8_t RTC_NextTimerTemperatureType(uint16_t *minutes_ahead);
+#endif
 int32_t RTC_DowTimerGetHourBar(uint8_t dow);
 void RTC_AddOneSecond(void);
 
@@ -42,45 +42,77 @@
 #include "watch.h"
 #include "debug.h"
 
-#define B8 0x0000
-#define B16 0x8000
-#define B_MASK 0x8000
+#if HOST_SIM
+	// host pointers are wider than 16 bits, keep the size flag in the top bit
+	typedef uintptr_t watch_ptr_t;
+	#define B16 ((uintptr_t)1 << (sizeof(uintptr_t)*8-1))
+	#define watch_map_read(p) (*(p))
+#else
+	typedef uint16_t watch_ptr_t;
+	#define B16 0x8000
+	#define watch_map_read(p) pgm_read_word(p)
+#endif
+#define B8 0
+#define B_MASK B16
 
 int16_t MOTOR_PosMax;
 
 
 #if DEBUG_MOTOR_COUNTER
-	#define WATCH_LAYOUT 0x85
+	#define WATCH_LAYOUT_MOTOR_COUNTER 0x80
+#else
+	#define WATCH_LAYOUT_MOTOR_COUNTER 0x00
+#endif
+#if MOTOR_COALESCE
+	#define WATCH_LAYOUT_COALESCE 0x40
 #else
-	#define WATCH_LAYOUT 0x05
+	#define WATCH_LAYOUT_COALESCE 0x00
 #endif
+#if BAT_FORECAST
+	#define WATCH_LAYOUT_BAT_FORECAST 0x20
+#else
+	#define WATCH_LAYOUT_BAT_FORECAST 0x00
+#endif
+#define WATCH_LAYOUT (0x05 | WATCH_LAYOUT_MOTOR_COUNTER | WATCH_LAYOUT_COALESCE | WATCH_LAYOUT_BAT_FORECAST)
 
 
-static const uint16_t watch_map[WATCH_N] PROGMEM =
+static const watch_ptr_t watch_map[WATCH_N] PROGMEM =
 {
-	/* 00 */ ((uint16_t) &sumError) + B16,
-	/* 01 */ ((uint16_t) &sumError)+ 2 + B16,
-	/* 02 */ ((uint16_t) &CTL_interatorCredit)+ B8,
-	/* 03 */ ((uint16_t) &CTL_creditExpiration)+ B8,
-	/* 04 */ ((uint16_t) &CTL_mode_window) + B8,
-	/* 05 */ ((uint16_t) &motor_diag) + B16,
-	/* 06 */ ((uint16_t) &MOTOR_PosMax) + B16,
-	/* 07 */ ((uint16_t) &MOTOR_PosAct) + B16,
-	/* 08 */ ((uint16_t) &MOTOR_PosOvershoot) + B8,
+	/* 00 */ ((watch_ptr_t) &sumError) + B16,
+	/* 01 */ ((watch_ptr_t) &sumError)+ 2 + B16,
+	/* 02 */ ((watch_ptr_t) &CTL_interatorCredit)+ B8,
+	/* 03 */ ((watch_ptr_t) &CTL_creditExpiration)+ B8,
+	/* 04 */ ((watch_ptr_t) &CTL_mode_window) + B8,
+	/* 05 */ ((watch_ptr_t) &motor_diag) + B16,
+	/* 06 */ ((watch_ptr_t) &MOTOR_PosMax) + B16,
+	/* 07 */ ((watch_ptr_t) &MOTOR_PosAct) + B16,
+	/* 08 */ ((watch_ptr_t) &MOTOR_PosOvershoot) + B8,
 #if DEBUG_MOTOR_COUNTER
-	/* 09 */ ((uint16_t) &MOTOR_counter) + B16,
-	/* 0a */ ((uint16_t) &MOTOR_counter)+ 2 + B16,
+	/* 09 */ ((watch_ptr_t) &MOTOR_counter) + B16,
+	/* 0a */ ((watch_ptr_t) &MOTOR_counter)+ 2 + B16,
+#endif
+#if MOTOR_COALESCE
+	// after the MOTOR_counter slots, they stay 0 without DEBUG_MOTOR_COUNTER
+	/* 0b */ [0x0b] = ((watch_ptr_t) &MOTOR_sched_runs) + B16,
+	/* 0c */ ((watch_ptr_t) &MOTOR_sched_cancelled) + B16,
+	/* 0d */ ((watch_ptr_t) &MOTOR_sched_dropped) + B16,
+	/* 0e */ ((watch_ptr_t) &MOTOR_start_cost) + B16,
+	/* 0f */ ((watch_ptr_t) &MOTOR_sched_pos) + B8,
+#endif
+#if BAT_FORECAST
+	// 10 with MOTOR_COALESCE, 0b without
+	[WATCH_N-1] = ((watch_ptr_t) &CTL_bat_days) + B16,
 #endif
 };
 
 uint16_t watch(uint8_t addr)
 {
-	uint16_t p;
+	watch_ptr_t p;
 
 	if (addr >= WATCH_N)
 		return WATCH_LAYOUT;
 
-	p=pgm_read_word(&watch_map[addr]);
+	p=watch_map_read(&watch_map[addr]);
 	if ((p&B_MASK) == B16) // 16 bit value
 		return *((uint16_t *)(p & ~B_MASK));
 	else
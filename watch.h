@@ -35,5 +35,14 @@
 
 uint16_t watch(uint8_t addr);
 
-#define WATCH_N (11)
+#if MOTOR_COALESCE
+#define WATCH_N_BASE (16)
+#else
+#define WATCH_N_BASE (11)
+#endif
+#if BAT_FORECAST
+#define WATCH_N (WATCH_N_BASE+1) // last slot is CTL_bat_days
+#else
+#define WATCH_N WATCH_N_BASE
+#endif
 
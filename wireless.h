@@ -82,6 +82,23 @@ extern uint32_t wl_force_flags;
 extern uint8_t wl_skip_sync;
 
 #if !defined(MASTER_CONFIG_H)
+/*!
+ *******************************************************************************
+ *  transmit slot of device \a addr in second \a sec of the minute
+ *
+ *  Every HR20 sends when the second counter is equal to its own address and
+ *  it has data (collision protection). The last sync packet can force
+ *  extra slots: odd/even seconds after 30 for wl_force_addr1/2, or
+ *  sec%30==addr for all devices flagged in wl_force_flags.
+ ******************************************************************************/
+static inline bool wireless_tx_slot(uint8_t sec, uint8_t addr, bool data,
+	uint8_t force1, uint8_t force2, uint32_t force_flags)
+{
+	return ((sec == addr) && data) ||
+		((sec > 30) && ((sec & 1) ? (force1 == addr) : (force2 == addr))) ||
+		((force1 == 0xff) && (sec % 30 == addr) && ((force_flags >> addr) & 1));
+}
+
 typedef enum {
     WL_TIMER_NONE,
     WL_TIMER_FIRST,